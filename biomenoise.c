@@ -171,9 +171,7 @@ void setNetherSeed(NetherNoise *nn, uint64_t seed)
     doublePerlinInit(&nn->humidity, &s, &nn->oct[4], &nn->oct[6], -7, 2);
 }
 
-/* Gets the 3D nether biome at scale 1:4 (for 1.16+).
- */
-int getNetherBiome(const NetherNoise *nn, int x, int y, int z, float *ndel)
+static int netherClimateToBiome(float temp, float humidity, float *ndel)
 {
     const float npoints[5][4] = {
         { 0,    0,      0,              nether_wastes       },
@@ -183,10 +181,6 @@ int getNetherBiome(const NetherNoise *nn, int x, int y, int z, float *ndel)
         {-0.5,  0,      0.175*0.175,    basalt_deltas       },
     };
 
-    y = 0;
-    float temp = sampleDoublePerlin(&nn->temperature, x, y, z);
-    float humidity = sampleDoublePerlin(&nn->humidity, x, y, z);
-
     int i, id = 0;
     float dmin = FLT_MAX;
     float dmin2 = FLT_MAX;
@@ -212,6 +206,53 @@ int getNetherBiome(const NetherNoise *nn, int x, int y, int z, float *ndel)
     return id;
 }
 
+/* Gets the 3D nether biome at scale 1:4 (for 1.16+).
+ */
+int getNetherBiome(const NetherNoise *nn, int x, int y, int z, float *ndel)
+{
+    y = 0;
+    float temp = sampleDoublePerlin(&nn->temperature, x, y, z);
+    float humidity = sampleDoublePerlin(&nn->humidity, x, y, z);
+    return netherClimateToBiome(temp, humidity, ndel);
+}
+
+/* Approximates the nether biomes of n <= NETHER_ROW cells along x, starting
+ * at (x, z) with the given step, from the float climate samplers. The biome
+ * is only kept when the noise delta exceeds what the sampling error can
+ * change, with some room for the float rounding in netherClimateToBiome().
+ * Otherwise the cell is set to -1. The kept noise deltas are reduced by the
+ * error, so they remain lower bounds for the exact ones.
+ */
+enum { NETHER_ROW = 64 };
+
+static void getNetherBiomesF(const NetherNoise *nn, int *ids, float *ndel,
+    int x, int z, int step, int n)
+{
+    double xs[NETHER_ROW], ys[NETHER_ROW], zs[NETHER_ROW];
+    float temp[NETHER_ROW], humidity[NETHER_ROW];
+    double et = getDoublePerlinErrorF(&nn->temperature);
+    double eh = getDoublePerlinErrorF(&nn->humidity);
+    // each distance in the climate space moves by at most the error radius
+    float margin = 2 * sqrt(et*et + eh*eh) + 1e-4;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        xs[i] = x + i * step;
+        ys[i] = 0;
+        zs[i] = z;
+    }
+    sampleDoublePerlinBatchF(&nn->temperature, temp, xs, ys, zs, n);
+    sampleDoublePerlinBatchF(&nn->humidity, humidity, xs, ys, zs, n);
+    for (i = 0; i < n; i++)
+    {
+        ids[i] = netherClimateToBiome(temp[i], humidity[i], &ndel[i]);
+        ndel[i] -= margin;
+        if (ndel[i] <= 0)
+            ids[i] = -1;
+    }
+}
+
 
 static void fillRad3D(int *out, int x, int y, int z, int sx, int sy, int sz,
     int id, float rad)
@@ -272,12 +313,18 @@ int mapNether3D(const NetherNoise *nn, int *out, Range r, float confidence)
     // cell that will have the same biome.
     float invgrad = 1.0 / (confidence * 0.05 * 2) / scale;
 
+    // The cells are first decided from approximate climate samples along
+    // the row, and only those close to a biome boundary are sampled exactly.
+    int aid[NETHER_ROW];
+    float adel[NETHER_ROW];
+
     for (k = 0; k < r.sy; k++)
     {
         int *yout = &out[k*r.sx*r.sz];
 
         for (j = 0; j < r.sz; j++)
         {
+            int64_t i0 = -NETHER_ROW;
             for (i = 0; i < r.sx; i++)
             {
                 if (yout[j*r.sx+i])
@@ -289,7 +336,20 @@ int mapNether3D(const NetherNoise *nn, int *out, Range r, float confidence)
                 int xi = (r.x+i)*scale;
                 int yk = (r.y+k);
                 int zj = (r.z+j)*scale;
-                int v = getNetherBiome(nn, xi, yk, zj, &noisedelta);
+                int v;
+                if (i >= i0 + NETHER_ROW)
+                {
+                    i0 = i;
+                    int n = r.sx - i < NETHER_ROW ? r.sx - i : NETHER_ROW;
+                    getNetherBiomesF(nn, aid, adel, xi, zj, scale, n);
+                }
+                if (aid[i-i0] >= 0)
+                {
+                    v = aid[i-i0];
+                    noisedelta = adel[i-i0];
+                }
+                else
+                    v = getNetherBiome(nn, xi, yk, zj, &noisedelta);
                 yout[j*r.sx+i] = v;
                 float cellrad = noisedelta * invgrad;
                 fillRad3D(out, i, j, k, r.sx, r.sy, r.sz, v, cellrad);
@@ -322,42 +382,20 @@ int genNetherScaled(const NetherNoise *nn, int *out, Range r, int mc, uint64_t s
 
     if (r.scale == 1)
     {
-        Range s = getVoronoiSrcRange(r);
-        int *src;
         if (siz > 1)
         {   // the source range is large enough that we can try optimizing
-            src = out + siz;
+            Range s = getVoronoiSrcRange(r);
+            int *src = out + siz;
             int err = mapNether3D(nn, src, s, 1.0);
             if (err)
                 return err;
+            mapVoronoi3D(sha, out, src, r.x, r.y, r.z, r.sx, r.sz, r.sy);
         }
         else
         {
-            src = NULL;
-        }
-
-        int i, j, k;
-        int *p = out;
-        for (k = 0; k < r.sy; k++)
-        {
-            for (j = 0; j < r.sz; j++)
-            {
-                for (i = 0; i < r.sx; i++)
-                {
-                    int x4, z4, y4;
-                    voronoiAccess3D(sha, r.x+i, r.y+k, r.z+j, &x4, &y4, &z4);
-                    if (src)
-                    {
-                        x4 -= s.x; y4 -= s.y; z4 -= s.z;
-                        *p = src[(int64_t)y4*s.sx*s.sz + (int64_t)z4*s.sx + x4];
-                    }
-                    else
-                    {
-                        *p = getNetherBiome(nn, x4, y4, z4, NULL);
-                    }
-                    p++;
-                }
-            }
+            int x4, z4, y4;
+            voronoiAccess3D(sha, r.x, r.y, r.z, &x4, &y4, &z4);
+            *out = getNetherBiome(nn, x4, y4, z4, NULL);
         }
         return 0;
     }
@@ -844,7 +882,8 @@ int genEndScaled(const EndNoise *en, int *out, Range r, int mc, uint64_t sha)
 
 static int init_climate_seed(
     DoublePerlinNoise *dpn, PerlinNoise *oct,
-    uint64_t xlo, uint64_t xhi, int large, int nptype, int nmax
+    uint64_t xlo, uint64_t xhi, int large, int nptype, int nmax,
+    PerlinQueue *q
     )
 {
     Xoroshiro pxr;
@@ -857,7 +896,7 @@ static int init_climate_seed(
         // md5 "minecraft:offset"
         pxr.lo = xlo ^ 0x080518cf6af25384;
         pxr.hi = xhi ^ 0x3f3dfb40a54febd5;
-        n += xDoublePerlinInit(dpn, &pxr, oct, amp, -3, 4, nmax);
+        n += xDoublePerlinInitQueue(dpn, &pxr, oct, amp, -3, 4, nmax, q);
         } break;
 
     case NP_TEMPERATURE: {
@@ -865,7 +904,7 @@ static int init_climate_seed(
         // md5 "minecraft:temperature" or "minecraft:temperature_large"
         pxr.lo = xlo ^ (large ? 0x944b0073edf549db : 0x5c7e6b29735f0d7f);
         pxr.hi = xhi ^ (large ? 0x4ff44347e9d22b96 : 0xf7d86f1bbc734988);
-        n += xDoublePerlinInit(dpn, &pxr, oct, amp, large ? -12 : -10, 6, nmax);
+        n += xDoublePerlinInitQueue(dpn, &pxr, oct, amp, large ? -12 : -10, 6, nmax, q);
         } break;
 
     case NP_HUMIDITY: {
@@ -873,7 +912,7 @@ static int init_climate_seed(
         // md5 "minecraft:vegetation" or "minecraft:vegetation_large"
         pxr.lo = xlo ^ (large ? 0x71b8ab943dbd5301 : 0x81bb4d22e8dc168e);
         pxr.hi = xhi ^ (large ? 0xbb63ddcf39ff7a2b : 0xf1c8b4bea16303cd);
-        n += xDoublePerlinInit(dpn, &pxr, oct, amp, large ? -10 : -8, 6, nmax);
+        n += xDoublePerlinInitQueue(dpn, &pxr, oct, amp, large ? -10 : -8, 6, nmax, q);
         } break;
 
     case NP_CONTINENTALNESS: {
@@ -881,7 +920,7 @@ static int init_climate_seed(
         // md5 "minecraft:continentalness" or "minecraft:continentalness_large"
         pxr.lo = xlo ^ (large ? 0x9a3f51a113fce8dc : 0x83886c9d0ae3a662);
         pxr.hi = xhi ^ (large ? 0xee2dbd157e5dcdad : 0xafa638a61b42e8ad);
-        n += xDoublePerlinInit(dpn, &pxr, oct, amp, large ? -11 : -9, 9, nmax);
+        n += xDoublePerlinInitQueue(dpn, &pxr, oct, amp, large ? -11 : -9, 9, nmax, q);
         } break;
 
     case NP_EROSION: {
@@ -889,7 +928,7 @@ static int init_climate_seed(
         // md5 "minecraft:erosion" or "minecraft:erosion_large"
         pxr.lo = xlo ^ (large ? 0x8c984b1f8702a951 : 0xd02491e6058f6fd8);
         pxr.hi = xhi ^ (large ? 0xead7b1f92bae535f : 0x4792512c94c17a80);
-        n += xDoublePerlinInit(dpn, &pxr, oct, amp, large ? -11 : -9, 5, nmax);
+        n += xDoublePerlinInitQueue(dpn, &pxr, oct, amp, large ? -11 : -9, 5, nmax, q);
         } break;
 
     case NP_WEIRDNESS: {
@@ -897,7 +936,7 @@ static int init_climate_seed(
         // md5 "minecraft:ridge"
         pxr.lo = xlo ^ 0xefc8ef4d36102b34;
         pxr.hi = xhi ^ 0x1beeeb324a0f24ea;
-        n += xDoublePerlinInit(dpn, &pxr, oct, amp, -7, 6, nmax);
+        n += xDoublePerlinInitQueue(dpn, &pxr, oct, amp, -7, 6, nmax, q);
         } break;
 
     default:
@@ -914,9 +953,13 @@ void setBiomeSeed(BiomeNoise *bn, uint64_t seed, int large)
     uint64_t xlo = xNextLong(&pxr);
     uint64_t xhi = xNextLong(&pxr);
 
+    // the octaves of all parameters are set up together
+    PerlinQueue q;
+    q.n = 0;
     int n = 0, i = 0;
     for (; i < NP_MAX; i++)
-        n += init_climate_seed(&bn->climate[i], bn->oct+n, xlo, xhi, large, i, -1);
+        n += init_climate_seed(&bn->climate[i], bn->oct+n, xlo, xhi, large, i, -1, &q);
+    xPerlinFlush(&q);
 
     if ((size_t)n > sizeof(bn->oct) / sizeof(*bn->oct))
     {
@@ -1110,9 +1153,100 @@ float getSpline(const Spline *sp, const float *vals)
     return r;
 }
 
-void initBiomeNoise(BiomeNoise *bn, int mc)
+/// Appends the spline sp to the flat spline and returns its node index
+static int compileSpline(FlatSpline *fs, const Spline **done, const Spline *sp)
 {
-    SplineStack *ss = &bn->ss;
+    int idx, i;
+    for (idx = 0; idx < fs->nlen; idx++)
+        if (done[idx] == sp)
+            return idx;
+
+    if (fs->nlen >= (int) (sizeof(fs->node) / sizeof(fs->node[0])) ||
+        fs->plen + sp->len > (int) (sizeof(fs->pt) / sizeof(fs->pt[0])))
+    {
+        printf("compileSpline(): FlatSpline is too small\n");
+        exit(1);
+    }
+
+    idx = fs->nlen++;
+    done[idx] = sp;
+    SplineNode *nd = &fs->node[idx];
+    nd->typ = sp->typ;
+    nd->len = sp->len;
+    nd->pt = fs->plen;
+    fs->plen += sp->len;
+
+    for (i = 0; i < sp->len; i++)
+    {
+        SplinePoint *pt = &fs->pt[nd->pt + i];
+        const Spline *val = sp->val[i];
+        pt->loc = sp->loc[i];
+        pt->der = sp->der[i];
+        if (val->len == 1)
+        {
+            pt->val = ((const FixSpline*)val)->val;
+            pt->child = -1;
+        }
+        else
+        {
+            pt->child = compileSpline(fs, done, val);
+        }
+        if (i > 0 && pt[-1].child < 0 && pt->child < 0)
+        {   // same operations as in getSpline()
+            float g = pt[-1].loc, h = pt->loc;
+            float l = pt[-1].der, m = pt->der;
+            float n = pt[-1].val, o = pt->val;
+            pt->p = l * (h - g) - (o - n);
+            pt->q = -m * (h - g) + (o - n);
+        }
+    }
+    return idx;
+}
+
+/// Evaluates node idx of a compiled spline, equivalent to getSpline()
+static float getFlatSpline(const FlatSpline *fs, int idx, const float *vals)
+{
+    const SplineNode *nd = &fs->node[idx];
+    const SplinePoint *pt = &fs->pt[nd->pt];
+    float f = vals[nd->typ];
+    int i, len = nd->len;
+
+    for (i = 0; i < len; i++)
+        if (pt[i].loc >= f)
+            break;
+    if (i == 0 || i == len)
+    {
+        if (i) i--;
+        float v = pt[i].child < 0 ? pt[i].val : getFlatSpline(fs, pt[i].child, vals);
+        return v + pt[i].der * (f - pt[i].loc);
+    }
+    const SplinePoint *pt1 = &pt[i-1];
+    const SplinePoint *pt2 = &pt[i];
+    float g = pt1->loc;
+    float h = pt2->loc;
+    float k = (f - g) / (h - g);
+    float n, o, p, q;
+    if (pt1->child < 0 && pt2->child < 0)
+    {
+        n = pt1->val;
+        o = pt2->val;
+        p = pt2->p;
+        q = pt2->q;
+    }
+    else
+    {
+        n = pt1->child < 0 ? pt1->val : getFlatSpline(fs, pt1->child, vals);
+        o = pt2->child < 0 ? pt2->val : getFlatSpline(fs, pt2->child, vals);
+        p = pt1->der * (h - g) - (o - n);
+        q = -pt2->der * (h - g) + (o - n);
+    }
+    return lerp(k, n, o) + k * (1.0F - k) * lerp(k, p, q);
+}
+
+/// Builds the overworld depth spline, which is the same for all seeds
+static void buildDepthSpline(FlatSpline *fs)
+{
+    SplineStack ssbuf, *ss = &ssbuf;
     memset(ss, 0, sizeof(*ss));
     Spline *sp = &ss->stack[ss->len++];
     sp->typ = SP_CONTINENTALNESS;
@@ -1133,11 +1267,82 @@ void initBiomeNoise(BiomeNoise *bn, int mc)
     addSplineVal(sp,  0.25F, sp3, 0.0F);
     addSplineVal(sp,  1.00F, sp4, 0.0F);
 
-    bn->sp = sp;
+    const Spline *done[sizeof(fs->node) / sizeof(fs->node[0])];
+    memset(fs, 0, sizeof(*fs));
+    compileSpline(fs, done, sp);
+}
+
+/* The depth spline is built once per process on first use and then shared,
+ * read-only, by all BiomeNoise instances. Concurrent first uses wait for the
+ * thread that builds it.
+ */
+static const FlatSpline *getDepthSpline(void)
+{
+    static FlatSpline fs;
+    static int state;
+    if (onceBegin(&state))
+    {
+        buildDepthSpline(&fs);
+        onceDone(&state);
+    }
+    return &fs;
+}
+
+void initBiomeNoise(BiomeNoise *bn, int mc)
+{
+    bn->sp = getDepthSpline();
     bn->mc = mc;
 }
 
 
+/// Offset of the depth parameter from the terrain spline (MC 1.18+)
+static double climateDepthOffset(const BiomeNoise *bn, float c, float e, float w)
+{
+    float np_param[] = {
+        c, e, -3.0F * ( fabsf( fabsf(w) - 0.6666667F ) - 0.33333334F ), w,
+    };
+    return getFlatSpline(bn->sp, 0, np_param) + 0.015F;
+}
+
+/// Fills the noise point of a position, given the depth offset
+static void climateNoisePoint(int64_t np[6], int y,
+    float t, float h, float c, float e, float w, double off,
+    uint32_t sample_flags)
+{
+    float d = 0;
+    if (!(sample_flags & SAMPLE_NO_DEPTH))
+    {
+        //double py = y + sampleDoublePerlin(&bn->shift, y, z, x) * 4.0;
+        d = 1.0 - (y * 4) / 128.0 - 83.0/160.0 + off;
+    }
+
+    np[0] = (int64_t)(10000.0F*t);
+    np[1] = (int64_t)(10000.0F*h);
+    np[2] = (int64_t)(10000.0F*c);
+    np[3] = (int64_t)(10000.0F*e);
+    np[4] = (int64_t)(10000.0F*d);
+    np[5] = (int64_t)(10000.0F*w);
+}
+
+/// Maps the sampled climate noise of a position to its biome (MC 1.18+)
+static int climateNoiseToBiome(const BiomeNoise *bn, int64_t *np, int y,
+    float t, float h, float c, float e, float w, uint64_t *dat,
+    uint32_t sample_flags)
+{
+    double off = 0;
+    if (!(sample_flags & SAMPLE_NO_DEPTH))
+        off = climateDepthOffset(bn, c, e, w);
+
+    int64_t l_np[6];
+    int64_t *p_np = np ? np : l_np;
+    climateNoisePoint(p_np, y, t, h, c, e, w, off, sample_flags);
+
+    int id = none;
+    if (!(sample_flags & SAMPLE_NO_BIOME))
+        id = climateToBiome(bn->mc, (const uint64_t*)p_np, dat);
+    return id;
+}
+
 /// Biome sampler for MC 1.18
 int sampleBiomeNoise(const BiomeNoise *bn, int64_t *np, int x, int y, int z,
     uint64_t *dat, uint32_t sample_flags)
@@ -1150,45 +1355,21 @@ int sampleBiomeNoise(const BiomeNoise *bn, int64_t *np, int x, int y, int z,
         return (int) id;
     }
 
-    float t = 0, h = 0, c = 0, e = 0, d = 0, w = 0;
+    float t = 0, h = 0, c = 0, e = 0, w = 0;
     double px = x, pz = z;
     if (!(sample_flags & SAMPLE_NO_SHIFT))
     {
-        px += sampleDoublePerlin(&bn->climate[NP_SHIFT], x, 0, z) * 4.0;
+        px += sampleDoublePerlin2D(&bn->climate[NP_SHIFT], NULL, x, z) * 4.0;
         pz += sampleDoublePerlin(&bn->climate[NP_SHIFT], z, x, 0) * 4.0;
     }
 
-    c = sampleDoublePerlin(&bn->climate[NP_CONTINENTALNESS], px, 0, pz);
-    e = sampleDoublePerlin(&bn->climate[NP_EROSION], px, 0, pz);
-    w = sampleDoublePerlin(&bn->climate[NP_WEIRDNESS], px, 0, pz);
-
-    if (!(sample_flags & SAMPLE_NO_DEPTH))
-    {
-        float np_param[] = {
-            c, e, -3.0F * ( fabsf( fabsf(w) - 0.6666667F ) - 0.33333334F ), w,
-        };
-        double off = getSpline(bn->sp, np_param) + 0.015F;
+    c = sampleDoublePerlin2D(&bn->climate[NP_CONTINENTALNESS], NULL, px, pz);
+    e = sampleDoublePerlin2D(&bn->climate[NP_EROSION], NULL, px, pz);
+    w = sampleDoublePerlin2D(&bn->climate[NP_WEIRDNESS], NULL, px, pz);
+    t = sampleDoublePerlin2D(&bn->climate[NP_TEMPERATURE], NULL, px, pz);
+    h = sampleDoublePerlin2D(&bn->climate[NP_HUMIDITY], NULL, px, pz);
 
-        //double py = y + sampleDoublePerlin(&bn->shift, y, z, x) * 4.0;
-        d = 1.0 - (y * 4) / 128.0 - 83.0/160.0 + off;
-    }
-
-    t = sampleDoublePerlin(&bn->climate[NP_TEMPERATURE], px, 0, pz);
-    h = sampleDoublePerlin(&bn->climate[NP_HUMIDITY], px, 0, pz);
-
-    int64_t l_np[6];
-    int64_t *p_np = np ? np : l_np;
-    p_np[0] = (int64_t)(10000.0F*t);
-    p_np[1] = (int64_t)(10000.0F*h);
-    p_np[2] = (int64_t)(10000.0F*c);
-    p_np[3] = (int64_t)(10000.0F*e);
-    p_np[4] = (int64_t)(10000.0F*d);
-    p_np[5] = (int64_t)(10000.0F*w);
-
-    int id = none;
-    if (!(sample_flags & SAMPLE_NO_BIOME))
-        id = climateToBiome(bn->mc, (const uint64_t*)p_np, dat);
-    return id;
+    return climateNoiseToBiome(bn, np, y, t, h, c, e, w, dat, sample_flags);
 }
 
 // Note: Climate noise is sampled at a 1:1 scale.
@@ -1385,54 +1566,303 @@ uint64_t get_np_dist(const uint64_t np[6], const BiomeTree *bt, int idx)
     return ds;
 }
 
-static
-int get_resulting_node(const uint64_t np[6], const BiomeTree *bt, int idx,
-    int alt, uint64_t ds, int depth)
+// the trees have up to 10 children per node, rounded up for the SIMD lanes
+enum { BTREE_MAX_DEPTH = 16, BTREE_MAX_ORDER = 12 };
+
+/// Distances of the n nodes idx + i*step, ds[] has room for BTREE_MAX_ORDER
+typedef void (*np_dists_t)(const uint64_t np[6], const BiomeTree *bt,
+    int idx, uint32_t step, int n, uint64_t *ds);
+
+static void get_np_dists(const uint64_t np[6], const BiomeTree *bt,
+    int idx, uint32_t step, int n, uint64_t *ds)
 {
-    if (bt->steps[depth] == 0)
-        return idx;
-    uint32_t step;
-    do
+    int i;
+    for (i = 0; i < n; i++)
+        ds[i] = get_np_dist(np, bt, idx + i*step);
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define BTREE_SIMD_X86 1
+#include <immintrin.h>
+
+/* Evaluates four sibling nodes per pass, with one lane per node. The squares
+ * are taken with a 32-bit multiply, so this is only exact (and only used)
+ * while every |np[i]| < BTREE_SIMD_RANGE, where no distance can overflow.
+ */
+#define BTREE_SIMD_RANGE ((int64_t)1 << 28)
+
+ATTR(target("avx2"))
+static void get_np_dists_avx2(const uint64_t np[6], const BiomeTree *bt,
+    int idx, uint32_t step, int n, uint64_t *ds)
+{
+    const long long *nodes = (const long long*) bt->nodes;
+    const long long *param = (const long long*) bt->param;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+    const __m256i m8 = _mm256_set1_epi64x(0xFF);
+    __m128i offs = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3),
+        _mm_set1_epi32(step));
+    int i, k;
+
+    for (i = 0; i < n; i += 4)
     {
-        step = bt->steps[depth];
-        depth++;
+        __m128i vidx = _mm_add_epi32(_mm_set1_epi32(idx + i*step), offs);
+        __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(n - i), lanes);
+        __m256i node = _mm256_mask_i32gather_epi64(zero, nodes, vidx, mask, 8);
+        __m256i acc = zero;
+
+        for (k = 0; k < 6; k++)
+        {
+            __m256i pi = _mm256_and_si256(_mm256_srli_epi64(node, 8*k), m8);
+            // {lo, hi} pair of int32, sign extended into separate lanes
+            __m256i g = _mm256_i64gather_epi64(param, pi, 8);
+            __m256i lo = _mm256_blend_epi32(g,
+                _mm256_srai_epi32(_mm256_slli_epi64(g, 32), 31), 0xAA);
+            __m256i hi = _mm256_blend_epi32(_mm256_srli_epi64(g, 32),
+                _mm256_srai_epi32(g, 31), 0xAA);
+            __m256i v = _mm256_set1_epi64x(np[k]);
+            __m256i a = _mm256_sub_epi64(v, hi);
+            __m256i b = _mm256_sub_epi64(lo, v);
+            __m256i ma = _mm256_cmpgt_epi64(a, zero);
+            __m256i mb = _mm256_andnot_si256(ma, _mm256_cmpgt_epi64(b, zero));
+            __m256i d = _mm256_or_si256(_mm256_and_si256(a, ma),
+                _mm256_and_si256(b, mb));
+            acc = _mm256_add_epi64(acc, _mm256_mul_epu32(d, d));
+        }
+        _mm256_storeu_si256((__m256i*)(ds + i), acc);
     }
-    while (idx+step >= bt->len);
+}
+#endif // BTREE_SIMD_X86
 
-    uint64_t node = bt->nodes[idx];
-    uint16_t inner = node >> 48;
+static np_dists_t get_np_dists_func(const uint64_t np[6])
+{
+#if BTREE_SIMD_X86
+    int i;
+    for (i = 0; i < 6; i++)
+    {
+        int64_t v = (int64_t) np[i];
+        if (v <= -BTREE_SIMD_RANGE || v >= BTREE_SIMD_RANGE)
+            return get_np_dists;
+    }
+    if (__builtin_cpu_supports("avx2"))
+        return get_np_dists_avx2;
+#else
+    (void) np;
+#endif
+    return get_np_dists;
+}
 
+/* Finds the leaf closest to np, starting with the best candidate alt at the
+ * distance ds. The tree is walked depth-first with an explicit stack, where
+ * the children of a node are visited in order and only entered while they
+ * are closer than the best leaf so far.
+ * With a non-NULL ds2, the walk also admits nodes up to the distance margin
+ * beyond the best leaf, and the distance of the closest other leaf is written
+ * to ds2, or just the limit of the walk if no other leaf comes that close.
+ */
+static
+int get_resulting_node(const uint64_t np[6], const BiomeTree *bt,
+    int alt, uint64_t ds, np_dists_t dists, uint64_t margin, uint64_t *ds2)
+{
+    struct {
+        uint64_t ds[BTREE_MAX_ORDER];
+        uint32_t step;
+        int inner, depth, i, n;
+    } stack[BTREE_MAX_DEPTH], *f;
+    int sp = 0, idx = 0, depth = 0;
     int leaf = alt;
-    uint32_t i, n;
+    uint64_t rival = -1, lim = ds;
 
-    for (i = 0, n = bt->order; i < n; i++)
+    if (ds2)
     {
-        uint64_t ds_inner = get_np_dist(np, bt, inner);
-        if (ds_inner < ds)
+        lim = ds + margin < ds ? (uint64_t) -1 : ds + margin;
+        *ds2 = lim;
+    }
+    if (bt->steps[0] == 0)
+        return 0;
+
+    for (;;)
+    {   // enter node idx at depth
+        f = &stack[sp++];
+        uint32_t step;
+        do
         {
-            int leaf2 = get_resulting_node(np, bt, inner, leaf, ds, depth);
-            uint64_t ds_leaf2;
-            if (inner == leaf2)
-                ds_leaf2 = ds_inner;
-            else
-                ds_leaf2 = get_np_dist(np, bt, leaf2);
-            if (ds_leaf2 < ds)
+            step = bt->steps[depth];
+            depth++;
+        }
+        while (idx+step >= bt->len);
+
+        f->inner = bt->nodes[idx] >> 48;
+        f->step = step;
+        f->depth = depth;
+        f->i = 0;
+        f->n = (bt->len - f->inner + step - 1) / step;
+        if (f->n > (int) bt->order)
+            f->n = bt->order;
+        dists(np, bt, f->inner, step, f->n, f->ds);
+
+        for (;;)
+        {
+            if (f->i == f->n)
+            {
+                if (--sp == 0)
+                {
+                    if (ds2)
+                        *ds2 = lim;
+                    return leaf;
+                }
+                f = &stack[sp-1];
+                continue;
+            }
+            int i = f->i++;
+            if (f->ds[i] >= lim)
+                continue;
+            int child = f->inner + i * f->step;
+            if (bt->steps[f->depth] == 0)
             {
-                ds = ds_leaf2;
-                leaf = leaf2;
+                if (f->ds[i] < ds)
+                {
+                    rival = ds;
+                    leaf = child;
+                    ds = f->ds[i];
+                }
+                else if (child != leaf && f->ds[i] < rival)
+                {
+                    rival = f->ds[i];
+                }
+                lim = ds2 && ds + margin >= ds ? ds + margin : ds;
+                if (lim > rival)
+                    lim = rival;
+                continue;
             }
+            idx = child;
+            depth = f->depth;
+            break;
         }
+    }
+}
 
-        inner += step;
-        if (inner >= bt->len)
-            break;
+/* Biome lookup cache: neighbouring samples often end up at the same leaf, so
+ * each thread remembers a few recent results together with the region around
+ * the sampled point inside which that leaf is proven to remain the unique
+ * closest one. The distance of a point to a node is the squared euclidean
+ * distance to its box, the root of which grows by at most as much as the
+ * point moves. So when the leaf was found at np with no other leaf closer
+ * than the root distance b, it still wins strictly at any point q for which
+ * |q - np| + sqrt(dist(q, leaf)) < b.
+ * The runner-up distance comes out of the search itself, when it is allowed
+ * to look up to BCACHE_MARGIN past the best leaf. This costs about as much as
+ * a second search, since it gives up stopping at the first containing leaf,
+ * so it is only done while the cached regions keep paying for themselves
+ * (and otherwise for one in BCACHE_PROBE searches, to notice when they do).
+ * The generated searches of BTREE_UNROLLED builds go without the cache.
+ */
+enum {
+    BCACHE_SIZE = 4,            // regions per thread, replaced round-robin
+    BCACHE_MARGIN = 1 << 22,    // squared, about 0.2 at the leaf
+    BCACHE_RANGE = 1 << 28,     // parameters beyond are left to the search
+    BCACHE_PROBE = 64,
+    BCACHE_CREDIT = 64,
+};
+
+STRUCT(BiomeCacheEntry)
+{
+    const BiomeTree *bt;
+    int64_t np[6];
+    double b;                   // root of the runner-up distance at np
+    uint64_t b2;
+    int leaf;
+};
+
+STRUCT(BiomeCache)
+{
+    BiomeCacheEntry e[BCACHE_SIZE];
+    int next;
+    int credit;                 // hits earned minus the cost of filling
+    int probe;
+};
+
+#if defined(__GNUC__)
+static __thread BiomeCache g_bcache;
+#elif defined(_MSC_VER)
+static __declspec(thread) BiomeCache g_bcache;
+#else
+static _Thread_local BiomeCache g_bcache;
+#endif
+
+static int inCacheRange(const uint64_t np[6])
+{
+    int i;
+    for (i = 0; i < 6; i++)
+    {
+        int64_t v = (int64_t) np[i];
+        if (v <= -BCACHE_RANGE || v >= BCACHE_RANGE)
+            return 0;
     }
+    return 1;
+}
 
-    return leaf;
+/// Returns the leaf of a cached region that contains np, or -1
+static int getCachedLeaf(const BiomeTree *bt, const uint64_t np[6])
+{
+    int i, j;
+    for (i = 0; i < BCACHE_SIZE; i++)
+    {
+        const BiomeCacheEntry *e = &g_bcache.e[i];
+        if (e->bt != bt)
+            continue;
+        uint64_t r2 = 0;
+        for (j = 0; j < 6; j++)
+        {
+            int64_t d = (int64_t)np[j] - e->np[j];
+            r2 += d * d;
+        }
+        if (r2 >= e->b2)
+            continue;
+        // one unit of slack covers the rounding of the roots
+        double r = sqrt((double) r2) + 1;
+        r += sqrt((double) get_np_dist(np, bt, e->leaf));
+        if (r < e->b)
+            return e->leaf;
+    }
+    return -1;
 }
 
-ATTR(hot, flatten)
-int climateToBiome(int mc, const uint64_t np[6], uint64_t *dat)
+static void setCachedLeaf(const BiomeTree *bt, const uint64_t np[6],
+    int leaf, uint64_t ds, uint64_t ds2)
+{
+    double b = sqrt((double) ds2);
+    int i;
+    if (b < sqrt((double) ds) + 2)
+        return;
+    BiomeCacheEntry *e = &g_bcache.e[g_bcache.next];
+    g_bcache.next = (g_bcache.next + 1) % BCACHE_SIZE;
+    e->bt = bt;
+    for (i = 0; i < 6; i++)
+        e->np[i] = (int64_t) np[i];
+    e->b = b;
+    e->b2 = ds2;
+    e->leaf = leaf;
+}
+
+/// Search of a whole tree for the leaf closest to np, see get_resulting_node()
+typedef int (*btree_search_t)(const uint64_t np[6], int alt, uint64_t *ds);
+
+#ifdef BTREE_UNROLLED
+// Compiled from the tables with docs/nptree_unroll.py (CMake BTREE_UNROLLED)
+int btree18_unrolled(const uint64_t np[6], int alt, uint64_t *ds);
+int btree192_unrolled(const uint64_t np[6], int alt, uint64_t *ds);
+int btree19_unrolled(const uint64_t np[6], int alt, uint64_t *ds);
+int btree20_unrolled(const uint64_t np[6], int alt, uint64_t *ds);
+int btree21wd_unrolled(const uint64_t np[6], int alt, uint64_t *ds);
+int btree215_unrolled(const uint64_t np[6], int alt, uint64_t *ds);
+#define BTREE_SEARCH(T) T ## _unrolled
+#else
+#define BTREE_SEARCH(T) NULL
+#endif
+
+static const BiomeTree *getBiomeTree(int mc, btree_search_t *search)
 {
     static const BiomeTree btree18 = {
         btree18_steps, &btree18_param[0][0], btree18_nodes, btree18_order,
@@ -1459,37 +1889,105 @@ int climateToBiome(int mc, const uint64_t np[6], uint64_t *dat)
         sizeof(btree215_nodes) / sizeof(uint64_t)
     };
 
-    const BiomeTree *bt;
-    int idx;
-
     if (mc >= MC_1_21_5)
-        bt = &btree215;
+    {
+        *search = BTREE_SEARCH(btree215);
+        return &btree215;
+    }
     else if (mc >= MC_1_21_WD)
-        bt = &btree21wd;
+    {
+        *search = BTREE_SEARCH(btree21wd);
+        return &btree21wd;
+    }
     else if (mc >= MC_1_20_6)
-        bt = &btree20;
+    {
+        *search = BTREE_SEARCH(btree20);
+        return &btree20;
+    }
     else if (mc >= MC_1_19_4)
-        bt = &btree19;
+    {
+        *search = BTREE_SEARCH(btree19);
+        return &btree19;
+    }
     else if (mc >= MC_1_19_2)
-        bt = &btree192;
+    {
+        *search = BTREE_SEARCH(btree192);
+        return &btree192;
+    }
     else
-        bt = &btree18;
+    {
+        *search = BTREE_SEARCH(btree18);
+        return &btree18;
+    }
+}
+
+static inline
+int treeToBiome(const BiomeTree *bt, btree_search_t search,
+    const uint64_t np[6], uint64_t *dat)
+{
+    int alt = 0, idx;
+    uint64_t ds = -1, ds2;
 
     if (dat)
     {
-        int alt = (int) *dat;
-        uint64_t ds = get_np_dist(np, bt, alt);
-        idx = get_resulting_node(np, bt, 0, alt, ds, 0);
-        *dat = (uint64_t) idx;
+        alt = (int) *dat;
+        ds = get_np_dist(np, bt, alt);
+    }
+    if (search)
+    {
+        idx = search(np, alt, &ds);
+    }
+    else if (!inCacheRange(np))
+    {
+        idx = get_resulting_node(np, bt, alt, ds, get_np_dists_func(np), 0, NULL);
+    }
+    else if ((idx = getCachedLeaf(bt, np)) >= 0)
+    {
+        if (g_bcache.credit < BCACHE_CREDIT)
+            g_bcache.credit++;
+        // the search keeps alt when it is just as close, which only the
+        // cached leaf itself or the (non-leaf) default hint can be
+        if (ds <= get_np_dist(np, bt, idx))
+            idx = alt;
+    }
+    else if (g_bcache.credit > 0 || ++g_bcache.probe == BCACHE_PROBE)
+    {   // a filled region has to be hit twice to cover its search
+        if ((g_bcache.credit -= 2) < -2)
+            g_bcache.credit = -2;
+        g_bcache.probe = 0;
+        idx = get_resulting_node(np, bt, alt, ds, get_np_dists_func(np),
+            BCACHE_MARGIN, &ds2);
+        if (idx)
+            setCachedLeaf(bt, np, idx, get_np_dist(np, bt, idx), ds2);
     }
     else
     {
-        idx = get_resulting_node(np, bt, 0, 0, -1, 0);
+        idx = get_resulting_node(np, bt, alt, ds, get_np_dists_func(np), 0, NULL);
     }
+    if (dat)
+        *dat = (uint64_t) idx;
 
     return (bt->nodes[idx] >> 48) & 0xFF;
 }
 
+ATTR(hot)
+int climateToBiome(int mc, const uint64_t np[6], uint64_t *dat)
+{
+    btree_search_t search;
+    const BiomeTree *bt = getBiomeTree(mc, &search);
+    return treeToBiome(bt, search, np, dat);
+}
+
+void climateToBiomeBatch(int mc, const uint64_t *np, int *ids, int n,
+    uint64_t *dat)
+{
+    btree_search_t search;
+    const BiomeTree *bt = getBiomeTree(mc, &search);
+    int i;
+    for (i = 0; i < n; i++)
+        ids[i] = treeToBiome(bt, search, np + 6*i, dat);
+}
+
 
 void setClimateParaSeed(BiomeNoise *bn, uint64_t seed, int large, int nptype, int nmax)
 {
@@ -1497,20 +1995,23 @@ void setClimateParaSeed(BiomeNoise *bn, uint64_t seed, int large, int nptype, in
     xSetSeed(&pxr, seed);
     uint64_t xlo = xNextLong(&pxr);
     uint64_t xhi = xNextLong(&pxr);
+    PerlinQueue q;
+    q.n = 0;
     if (nptype == NP_DEPTH)
     {
         int n = 0;
         n += init_climate_seed(bn->climate + NP_CONTINENTALNESS,
-            bn->oct + n, xlo, xhi, large,    NP_CONTINENTALNESS, nmax);
+            bn->oct + n, xlo, xhi, large,    NP_CONTINENTALNESS, nmax, &q);
         n += init_climate_seed(bn->climate + NP_EROSION,
-            bn->oct + n, xlo, xhi, large,    NP_EROSION, nmax);
+            bn->oct + n, xlo, xhi, large,    NP_EROSION, nmax, &q);
         n += init_climate_seed(bn->climate + NP_WEIRDNESS,
-            bn->oct + n, xlo, xhi, large,    NP_WEIRDNESS, nmax);
+            bn->oct + n, xlo, xhi, large,    NP_WEIRDNESS, nmax, &q);
     }
     else
     {
-        init_climate_seed(bn->climate + nptype, bn->oct, xlo, xhi, large, nptype, nmax);
+        init_climate_seed(bn->climate + nptype, bn->oct, xlo, xhi, large, nptype, nmax, &q);
     }
+    xPerlinFlush(&q);
     bn->nptype = nptype;
 }
 
@@ -1526,7 +2027,7 @@ double sampleClimatePara(const BiomeNoise *bn, int64_t *np, double x, double z)
         float np_param[] = {
             c, e, -3.0F * ( fabsf( fabsf(w) - 0.6666667F ) - 0.33333334F ), w,
         };
-        double off = getSpline(bn->sp, np_param) + 0.015F;
+        double off = getFlatSpline(bn->sp, 0, np_param) + 0.015F;
         int y = 0;
         float d = 1.0 - (y * 4) / 128.0 - 83.0/160.0 + off;
         if (np)
@@ -1567,21 +2068,148 @@ void genBiomeNoiseChunkSection(const BiomeNoise *bn, int out[4][4][4],
     }
 }
 
-static void genBiomeNoise3D(const BiomeNoise *bn, int *out, Range r, int opt)
+/// The climate of a column, everything except the depth is independent of y
+STRUCT(ClimateColumn)
 {
-    uint64_t dat = 0;
-    uint64_t *p_dat = opt ? &dat : NULL;
-    uint32_t flags = opt ? SAMPLE_NO_SHIFT : 0;
-    int i, j, k;
+    float t, h, c, e, w;
+    double off;
+};
+
+/* Samples the climate of the n columns (x0 + i*dx, z), evaluating the noise
+ * of the row in batches. The y = 0 lookup planes of each climate noise are
+ * optional (NULL entries).
+ */
+static void sampleClimateRow(const BiomeNoise *bn,
+    const PerlinPlane *const *planes, ClimateColumn *col, int x0, int dx,
+    int z, int n, uint32_t sample_flags)
+{
+    enum { B = 64 };
+    double xs[B], ys[B], zs[B], px[B], pz[B], v[B];
+    int b, i, m;
+
+    for (b = 0; b < n; b += m, col += m)
+    {
+        m = n - b < B ? n - b : B;
+        for (i = 0; i < m; i++)
+        {
+            xs[i] = px[i] = x0 + (b+i) * dx;
+            zs[i] = pz[i] = z;
+            ys[i] = 0;
+        }
+        if (!(sample_flags & SAMPLE_NO_SHIFT))
+        {
+            sampleDoublePerlinBatch2D(&bn->climate[NP_SHIFT], planes[NP_SHIFT],
+                v, xs, zs, m);
+            for (i = 0; i < m; i++)
+                px[i] += v[i] * 4.0;
+            sampleDoublePerlinBatch(&bn->climate[NP_SHIFT], v, zs, xs, ys, m);
+            for (i = 0; i < m; i++)
+                pz[i] += v[i] * 4.0;
+        }
+
+        sampleDoublePerlinBatch2D(&bn->climate[NP_CONTINENTALNESS],
+            planes[NP_CONTINENTALNESS], v, px, pz, m);
+        for (i = 0; i < m; i++) col[i].c = v[i];
+        sampleDoublePerlinBatch2D(&bn->climate[NP_EROSION],
+            planes[NP_EROSION], v, px, pz, m);
+        for (i = 0; i < m; i++) col[i].e = v[i];
+        sampleDoublePerlinBatch2D(&bn->climate[NP_WEIRDNESS],
+            planes[NP_WEIRDNESS], v, px, pz, m);
+        for (i = 0; i < m; i++) col[i].w = v[i];
+        sampleDoublePerlinBatch2D(&bn->climate[NP_TEMPERATURE],
+            planes[NP_TEMPERATURE], v, px, pz, m);
+        for (i = 0; i < m; i++) col[i].t = v[i];
+        sampleDoublePerlinBatch2D(&bn->climate[NP_HUMIDITY],
+            planes[NP_HUMIDITY], v, px, pz, m);
+        for (i = 0; i < m; i++) col[i].h = v[i];
+
+        for (i = 0; i < m; i++)
+        {
+            col[i].off = 0;
+            if (!(sample_flags & SAMPLE_NO_DEPTH))
+                col[i].off = climateDepthOffset(bn, col[i].c, col[i].e, col[i].w);
+        }
+    }
+}
+
+/* Builds the y = 0 lookup planes of all climate noises into buf (room for
+ * one plane per octave in bn->oct) and points planes[] into it.
+ */
+static void initClimatePlanes(const BiomeNoise *bn, PerlinPlane *buf,
+    const PerlinPlane **planes)
+{
+    int np;
+    for (np = 0; np < NP_MAX; np++)
+    {
+        planes[np] = buf;
+        buf += doublePerlinPlaneInit(buf, &bn->climate[np]);
+    }
+}
+
+/* Generates the biomes of the range from the climate noise. With the optional
+ * lookup hint 'p_dat' the local distortions are skipped and each lookup
+ * starts from the previous one (see genBiomeNoiseScaled()).
+ */
+static void genBiomeNoise3D(const BiomeNoise *bn, int *out, Range r,
+    uint64_t *p_dat)
+{
+    uint32_t flags = p_dat ? SAMPLE_NO_SHIFT : 0;
+    int i, j, k, l, m;
     int *p = out;
     int scale = r.scale > 4 ? r.scale / 4 : 1;
     int mid = scale / 2;
+    enum { B = 64 };
+    int64_t np[B][6];
+
+    // The climate of a column is sampled once and kept for all y levels, so
+    // the per-cell work of a volume is just the depth and the biome lookup.
+    ClimateColumn *cols = NULL;
+    if (bn->nptype < 0)
+    {
+        size_t n = (size_t) r.sx * (r.sy > 1 ? r.sz : 1);
+        cols = (ClimateColumn*) malloc(n * sizeof(ClimateColumn));
+    }
+
+    // The lookup planes take about as long to build as a few hundred samples
+    // and are only worth it for larger areas.
+    const PerlinPlane *planes[NP_MAX] = {0};
+    PerlinPlane *buf = NULL;
+    if (cols && (uint64_t)r.sx*r.sz >= 1024)
+    {
+        buf = (PerlinPlane*) malloc(sizeof(bn->oct) / sizeof(*bn->oct) *
+            sizeof(PerlinPlane));
+        if (buf)
+            initClimatePlanes(bn, buf, planes);
+    }
+
     for (k = 0; k < r.sy; k++)
     {
         int yk = (r.y+k);
         for (j = 0; j < r.sz; j++)
         {
             int zj = (r.z+j)*scale + mid;
+            if (cols)
+            {
+                ClimateColumn *col = cols + (r.sy > 1 ? (size_t)j*r.sx : 0);
+                if (k == 0)
+                {
+                    sampleClimateRow(bn, planes, col, r.x*scale + mid, scale,
+                        zj, r.sx, flags);
+                }
+                for (i = 0; i < r.sx; i += m)
+                {
+                    m = r.sx - i < B ? r.sx - i : B;
+                    for (l = 0; l < m; l++, col++)
+                    {
+                        climateNoisePoint(np[l], yk, col->t, col->h, col->c,
+                            col->e, col->w, col->off, flags);
+                    }
+                    climateToBiomeBatch(bn->mc, (const uint64_t*) &np[0][0],
+                        p, m, p_dat);
+                    p += m;
+                }
+                continue;
+            }
             for (i = 0; i < r.sx; i++)
             {
                 int xi = (r.x+i)*scale + mid;
@@ -1590,6 +2218,8 @@ static void genBiomeNoise3D(const BiomeNoise *bn, int *out, Range r, int opt)
             }
         }
     }
+    free(buf);
+    free(cols);
 }
 
 int genBiomeNoiseScaled(const BiomeNoise *bn, int *out, Range r, uint64_t sha)
@@ -1598,43 +2228,21 @@ int genBiomeNoiseScaled(const BiomeNoise *bn, int *out, Range r, uint64_t sha)
         r.sy = 1;
 
     uint64_t siz = (uint64_t)r.sx*r.sy*r.sz;
-    int i, j, k;
 
     if (r.scale == 1)
     {
-        Range s = getVoronoiSrcRange(r);
-        int *src;
         if (siz > 1)
         {   // the source range is large enough that we can try optimizing
-            src = out + siz;
-            genBiomeNoise3D(bn, src, s, 0);
+            Range s = getVoronoiSrcRange(r);
+            int *src = out + siz;
+            genBiomeNoise3D(bn, src, s, NULL);
+            mapVoronoi3D(sha, out, src, r.x, r.y, r.z, r.sx, r.sz, r.sy);
         }
         else
         {
-            src = NULL;
-        }
-
-        int *p = out;
-        for (k = 0; k < r.sy; k++)
-        {
-            for (j = 0; j < r.sz; j++)
-            {
-                for (i = 0; i < r.sx; i++)
-                {
-                    int x4, z4, y4;
-                    voronoiAccess3D(sha, r.x+i, r.y+k, r.z+j, &x4, &y4, &z4);
-                    if (src)
-                    {
-                        x4 -= s.x; y4 -= s.y; z4 -= s.z;
-                        *p = src[(int64_t)y4*s.sx*s.sz + (int64_t)z4*s.sx + x4];
-                    }
-                    else
-                    {
-                        *p = sampleBiomeNoise(bn, 0, x4, y4, z4, 0, 0);
-                    }
-                    p++;
-                }
-            }
+            int x4, z4, y4;
+            voronoiAccess3D(sha, r.x, r.y, r.z, &x4, &y4, &z4);
+            *out = sampleBiomeNoise(bn, 0, x4, y4, z4, 0, 0);
         }
     }
     else
@@ -1644,11 +2252,55 @@ int genBiomeNoiseScaled(const BiomeNoise *bn, int *out, Range r, uint64_t sha)
         // than 1:4, the accuracy becomes questionable anyway. Furthermore
         // situations that want to use a higher scale are usually better off
         // with a faster, if imperfect, result.
-        genBiomeNoise3D(bn, out, r, r.scale > 4);
+        uint64_t dat = 0;
+        genBiomeNoise3D(bn, out, r, r.scale > 4 ? &dat : NULL);
     }
     return 0;
 }
 
+int genBiomeNoiseHinted(const BiomeNoise *bn, int *out, Range r,
+    uint64_t *dat)
+{
+    if (r.scale <= 4)
+        return 1; // the lookups are only hinted above 1:4
+    if (r.sy == 0)
+        r.sy = 1;
+    genBiomeNoise3D(bn, out, r, dat);
+    return 0;
+}
+
+uint64_t fixBiomeNoiseHint(const BiomeNoise *bn, int *out, Range r,
+    uint64_t dat, uint64_t end)
+{
+    if (r.scale <= 4 || bn->nptype >= 0)
+        return end;
+    if (r.sy == 0)
+        r.sy = 1;
+
+    int scale = r.scale / 4;
+    int mid = scale / 2;
+    uint64_t alt = 0; // hint of the lookups as they were generated
+    int64_t np[6];
+    int i, j, k;
+
+    for (k = 0; k < r.sy; k++)
+    {
+        for (j = 0; j < r.sz; j++)
+        {
+            for (i = 0; i < r.sx; i++)
+            {
+                sampleBiomeNoise(bn, np, (r.x+i)*scale + mid, r.y+k,
+                    (r.z+j)*scale + mid, NULL, SAMPLE_NO_SHIFT|SAMPLE_NO_BIOME);
+                climateToBiome(bn->mc, (const uint64_t*) np, &alt);
+                *out++ = climateToBiome(bn->mc, (const uint64_t*) np, &dat);
+                if (alt == dat)
+                    return end; // the lookups agree from here on
+            }
+        }
+    }
+    return dat;
+}
+
 static void genColumnNoise(const SurfaceNoiseBeta *snb, SeaLevelColumnNoiseBeta *dest,
     double cx, double cz, double lacmin)
 {
@@ -1764,8 +2416,8 @@ int genBiomeNoiseBetaScaled(const BiomeNoiseBeta *bnb,
     int cellwidth = r.scale >> 1;
     int cx1 = r.x >> (2 >> cellwidth);
     int cz1 = r.z >> (2 >> cellwidth);
-    int cx2 = cx1 + (r.sx >> (2 >> cellwidth)) + 1;
-    int cz2 = cz1 + (r.sz >> (2 >> cellwidth)) + 1;
+    int cx2 = ((r.x + r.sx - 1) >> (2 >> cellwidth)) + 1;
+    int cz2 = ((r.z + r.sz - 1) >> (2 >> cellwidth)) + 1;
     int steps = 4 >> cellwidth;
     int minDim, maxDim;
     if (cx2-cx1 > cz2-cz1) {
@@ -114,6 +114,30 @@ STRUCT(SplineStack)
     int len, flen;
 };
 
+STRUCT(SplinePoint)
+{
+    float loc, der;
+    float val;      // value of a constant child spline
+    int child;      // index of the child spline, or -1 for a constant
+    float p, q;     // Hermite terms of the segment ending at this point,
+                    // if the values at both of its ends are constant
+};
+
+STRUCT(SplineNode)
+{
+    uint8_t typ, len;
+    uint16_t pt;    // index of the first point
+};
+
+STRUCT(FlatSpline)
+{   // Spline graph compiled to arrays, with the root at node 0. The sizes
+    // here are just sufficient for the overworld depth spline, compiling a
+    // larger spline is a fatal error.
+    SplineNode node[37];
+    SplinePoint pt[180];
+    int nlen, plen;
+};
+
 
 enum
 {
@@ -130,8 +154,7 @@ STRUCT(BiomeNoise)
 {
     DoublePerlinNoise climate[NP_MAX];
     PerlinNoise oct[2*23]; // buffer for octaves in double perlin noise
-    Spline *sp;
-    SplineStack ss;
+    const FlatSpline *sp;   // shared depth spline
     int nptype;
     int mc;
 };
@@ -263,6 +286,14 @@ int getOldBetaBiome(float t, float h);
  */
 int climateToBiome(int mc, const uint64_t np[6], uint64_t *dat);
 
+/**
+ * Maps the n noise points np[6*i + 0..5] to ids[i], the same as calling
+ * climateToBiome() for each in order (a hint in dat carries over from one
+ * point to the next).
+ */
+void climateToBiomeBatch(int mc, const uint64_t *np, int *ids, int n,
+    uint64_t *dat);
+
 /**
  * Initialize BiomeNoise for only a single climate parameter.
  * If nptype == NP_DEPTH, the value is sampled at y=0. Note that this value
@@ -292,6 +323,23 @@ void genBiomeNoiseChunkSection(const BiomeNoise *bn, int out[4][4][4],
  */
 int genBiomeNoiseScaled(const BiomeNoise *bn, int *out, Range r, uint64_t sha);
 
+/**
+ * At scales above 1:4, genBiomeNoiseScaled() starts each biome lookup from
+ * the result of the previous one in the order of the output, which can
+ * change the biome (MC-241546). To split such a range into parts that are
+ * generated independently, genBiomeNoiseHinted() takes the lookup hint
+ * before the first biome in 'dat' (zero at the start of a range) and leaves
+ * the hint after the last one there. A part that was generated from the hint
+ * zero is then corrected with fixBiomeNoiseHint(), given the hint 'dat' of
+ * the preceding part and its own final hint 'end'. This redoes the lookups
+ * at the start of the part until they agree with the generated ones, and
+ * returns the hint after the part.
+ */
+int genBiomeNoiseHinted(const BiomeNoise *bn, int *out, Range r,
+    uint64_t *dat);
+uint64_t fixBiomeNoiseHint(const BiomeNoise *bn, int *out, Range r,
+    uint64_t dat, uint64_t end);
+
 /**
  * Generates the biomes for Beta 1.7, the surface noise is optional and enables
  * ocean mapping in areas that fall below the sea level.
@@ -1,4 +1,5 @@
 #include "biomes.h"
+#include "rng.h"
 #include <inttypes.h>
 
 
@@ -453,3 +454,73 @@ int isSnowy(int id)
 }
 
 
+
+
+//==============================================================================
+// Biome Property Tables
+//==============================================================================
+
+static void buildBiomeProps(BiomeProps *bp, int mc)
+{
+    int classOf[256+1]; // class of each category, offset by one for none
+    int ncls = 0;
+    int id, plateauCls = -1;
+
+    for (id = 0; id <= 256; id++)
+        classOf[id] = -1;
+
+    if (mc <= MC_1_15)
+    {   // the badlands plateaus are only similar to each other
+        plateauCls = ncls++;
+    }
+
+    for (id = 0; id < 256; id++)
+    {
+        int cat = getCategory(mc, id);
+        int flags = 0;
+
+        if (isOceanic(id))          flags |= BF_OCEANIC;
+        if (isShallowOcean(id))     flags |= BF_SHALLOW;
+        if (isDeepOcean(id))        flags |= BF_DEEP;
+        if (isMesa(id))             flags |= BF_MESA;
+        if (isSnowy(id))            flags |= BF_SNOWY;
+        if (isOverworld(mc, id))    flags |= BF_OVERWORLD;
+
+        if (classOf[cat+1] < 0)
+            classOf[cat+1] = ncls++;
+
+        bp->category[id] = cat;
+        bp->mutated[id] = getMutated(mc, id);
+        bp->flags[id] = flags;
+        bp->simClass[id] = classOf[cat+1];
+        bp->simMask[id] = 1U << classOf[cat+1];
+
+        if (plateauCls >= 0 &&
+            (id == wooded_badlands_plateau || id == badlands_plateau))
+        {
+            bp->simClass[id] = plateauCls;
+            bp->simMask[id] |= 1U << plateauCls;
+        }
+    }
+}
+
+/* Built on first use per version, as the depth spline of the biome noise:
+ * concurrent first uses wait for the thread that builds the table.
+ */
+const BiomeProps *getBiomeProps(int mc)
+{
+    static BiomeProps props[MC_NEWEST+1];
+    static int state[MC_NEWEST+1];
+
+    if (mc < MC_UNDEF)
+        mc = MC_UNDEF;
+    if (mc > MC_NEWEST)
+        mc = MC_NEWEST;
+
+    if (onceBegin(&state[mc]))
+    {
+        buildBiomeProps(&props[mc], mc);
+        onceDone(&state[mc]);
+    }
+    return &props[mc];
+}
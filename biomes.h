@@ -1,6 +1,8 @@
 #ifndef BIOMES_H_
 #define BIOMES_H_
 
+#include <stdint.h>
+
 /* Minecraft versions */
 enum MCVersion
 {   // MC_1_X refers to the latest patch of the respective 1.X release.
@@ -200,6 +202,67 @@ int isDeepOcean(int id);
 int isOceanic(int id);
 int isSnowy(int id);
 
+
+//==============================================================================
+// Biome Property Tables
+//==============================================================================
+
+/* The helpers above are switches and comparison chains, several of which
+ * depend on the version. For the per-cell loops of the layers, the same
+ * properties are tabulated for each version, indexed by the biome ID. The
+ * tables are built on first use and are read-only afterwards. IDs outside
+ * of [0, 255] share the properties of 255, which is not a biome.
+ */
+enum
+{
+    BF_OCEANIC      = 0x01, // isOceanic()
+    BF_SHALLOW      = 0x02, // isShallowOcean()
+    BF_DEEP         = 0x04, // isDeepOcean()
+    BF_MESA         = 0x08, // isMesa()
+    BF_SNOWY        = 0x10, // isSnowy()
+    BF_OVERWORLD    = 0x20, // isOverworld()
+};
+
+typedef struct BiomeProps BiomeProps;
+struct BiomeProps
+{
+    int16_t category[256];  // getCategory()
+    int16_t mutated[256];   // getMutated()
+    uint8_t flags[256];     // BF_* flags
+    // areSimilar(id1, id2) for id1 != id2: similarity class of id1, and the
+    // bit mask of the classes that id2 is similar to
+    uint8_t simClass[256];
+    uint32_t simMask[256];
+};
+
+const BiomeProps *getBiomeProps(int mc);
+
+static inline int bpIndex(int id)
+{
+    return (uint32_t) id < 256 ? id : 255;
+}
+
+static inline int bpCategory(const BiomeProps *bp, int id)
+{
+    return bp->category[bpIndex(id)];
+}
+
+static inline int bpMutated(const BiomeProps *bp, int id)
+{
+    return bp->mutated[bpIndex(id)];
+}
+
+static inline int bpIs(const BiomeProps *bp, int id, int flags)
+{
+    return bp->flags[bpIndex(id)] & flags;
+}
+
+static inline int bpSimilar(const BiomeProps *bp, int id1, int id2)
+{
+    return id1 == id2 ||
+        ((bp->simMask[bpIndex(id2)] >> bp->simClass[bpIndex(id1)]) & 1);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,112 @@
+import sys
+import re
+
+if len(sys.argv) <= 1:
+    msg = \
+    """
+    usage: {0} TABLE [OUT]
+    Compiles a binary biome tree table (tables/btreeXX.h, as generated by
+    nptree_bin.py) into a C search function with the traversal fully unrolled
+    and the parameter bounds inlined as constants. The function is named after
+    the table, e.g. btree21wd_unrolled(), and returns the index of the closest
+    leaf node, exactly as the table search in climateToBiome() does.
+    """.format(sys.argv[0])
+    print(msg)
+    sys.exit(0)
+
+in_file = sys.argv[1]
+out_file = sys.argv[2] if len(sys.argv) > 2 else None
+
+with open(in_file) as f:
+    src = f.read()
+
+name = re.search(r'enum \{ ([a-z0-9]+)_order = ([0-9]+) \}', src)
+name, order = name.group(1), int(name.group(2))
+
+
+def block(tag):
+    s = src[src.index(name + tag):]
+    s = s[s.index('{')+1:s.index('};')]
+    return re.sub(r'//[^\n]*', '', s)
+
+steps = [int(x) for x in re.findall(r'[0-9]+', block('_steps'))]
+nums = [int(x) for x in re.findall(r'-?[0-9]+', block('_param'))]
+param = [(nums[i], nums[i+1]) for i in range(0, len(nums), 2)]
+nodes = [int(x, 16) for x in re.findall(r'0x([0-9A-Fa-f]+)', block('_nodes'))]
+
+
+def bounds(idx):
+    node = nodes[idx]
+    return ', '.join(['{},{}'.format(*param[(node >> 8*i) & 0xFF]) for i in range(6)])
+
+
+# Mirrors the table search: the children of an inner node start at the index
+# in its top two bytes and are spaced by the step of the next tree level that
+# still fits inside the table.
+funcs = dict()
+
+def gen(idx, depth):
+    while True:
+        step = steps[depth]
+        depth += 1
+        if idx + step < len(nodes):
+            break
+    inner = nodes[idx] >> 48
+    lines = []
+    for i in range(order):
+        if steps[depth] == 0:
+            lines.append('    d = NP_DIST({}); if (d < *ds) {{ *ds = d; leaf = {}; }}'
+                .format(bounds(inner), inner))
+        else:
+            gen(inner, depth)
+            lines.append('    d = NP_DIST({}); if (d < *ds) leaf = {}_{}(np, leaf, ds);'
+                .format(bounds(inner), name, inner))
+        inner += step
+        if inner >= len(nodes):
+            break
+    funcs[idx] = lines
+
+gen(0, 0)
+
+
+out = open(out_file, 'w') if out_file else sys.stdout
+
+def emit(s=''):
+    out.write(s + '\n')
+
+emit('// Generated by docs/nptree_unroll.py from {}, do not edit.'.format(
+    re.sub(r'.*[/\\]', 'tables/', in_file)))
+emit('#include <stdint.h>')
+emit()
+emit('static inline uint64_t np_dist1(uint64_t v, int64_t lo, int64_t hi)')
+emit('{')
+emit('    uint64_t a = v - (uint64_t)hi;')
+emit('    uint64_t b = (uint64_t)lo - v;')
+emit('    uint64_t d = (int64_t)a > 0 ? a : (int64_t)b > 0 ? b : 0;')
+emit('    return d * d;')
+emit('}')
+emit()
+emit('#define NP_DIST(l0,h0, l1,h1, l2,h2, l3,h3, l4,h4, l5,h5) ( \\')
+emit('    np_dist1(np[0],l0,h0) + np_dist1(np[1],l1,h1) + np_dist1(np[2],l2,h2) + \\')
+emit('    np_dist1(np[3],l3,h3) + np_dist1(np[4],l4,h4) + np_dist1(np[5],l5,h5) )')
+emit()
+for idx in sorted(funcs):
+    if idx:
+        emit('static int {}_{}(const uint64_t np[6], int leaf, uint64_t *ds);'.format(name, idx))
+emit()
+emit('int {}_unrolled(const uint64_t np[6], int leaf, uint64_t *ds);'.format(name))
+for idx in sorted(funcs):
+    emit()
+    if idx:
+        emit('static int {}_{}(const uint64_t np[6], int leaf, uint64_t *ds)'.format(name, idx))
+    else:
+        emit('int {}_unrolled(const uint64_t np[6], int leaf, uint64_t *ds)'.format(name))
+    emit('{')
+    emit('    uint64_t d;')
+    for l in funcs[idx]:
+        emit(l)
+    emit('    return leaf;')
+    emit('}')
+
+if out_file:
+    out.close()
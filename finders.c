@@ -1181,6 +1181,8 @@ Pos getSpawn(const Generator *g)
 
 int isViableFeatureBiome(int mc, int structureType, int biomeID)
 {
+    const BiomeProps *bp = getBiomeProps(mc);
+
     switch (structureType)
     {
     case Desert_Pyramid:
@@ -1199,11 +1201,11 @@ int isViableFeatureBiome(int mc, int structureType, int biomeID)
 
     case Ocean_Ruin:
         if (mc <= MC_1_12) return 0;
-        return isOceanic(biomeID);
+        return bpIs(bp, biomeID, BF_OCEANIC);
 
     case Shipwreck:
         if (mc <= MC_1_12) return 0;
-        return isOceanic(biomeID) || biomeID == beach || biomeID == snowy_beach;
+        return bpIs(bp, biomeID, BF_OCEANIC) || biomeID == beach || biomeID == snowy_beach;
 
     case Ruined_Portal:
     case Ruined_Portal_N:
@@ -1231,21 +1233,21 @@ int isViableFeatureBiome(int mc, int structureType, int biomeID)
 
     case Trial_Chambers:
         if (mc <= MC_1_20) return 0;
-        return biomeID != deep_dark && isOverworld(mc, biomeID);
+        return biomeID != deep_dark && bpIs(bp, biomeID, BF_OVERWORLD);
 
     case Treasure:
         if (mc <= MC_1_12) return 0;
         return biomeID == beach || biomeID == snowy_beach;
 
     case Mineshaft:
-        return isOverworld(mc, biomeID);
+        return bpIs(bp, biomeID, BF_OVERWORLD);
 
     case Desert_Well:
         return biomeID == desert;
 
     case Monument:
         if (mc <= MC_1_7) return 0;
-        return isDeepOcean(biomeID);
+        return bpIs(bp, biomeID, BF_DEEP);
 
     case Outpost:
         if (mc <= MC_1_13) return 0;
@@ -1318,6 +1320,7 @@ static int mapViableBiome(const Layer * l, int * out, int x, int z, int w, int h
     if unlikely(err != 0)
         return err;
 
+    const BiomeProps *bp = getBiomeProps(l->mc);
     int styp = ((const int*) l->data)[0];
     int i, j;
 
@@ -1330,7 +1333,7 @@ static int mapViableBiome(const Layer * l, int * out, int x, int z, int w, int h
             {
             case Desert_Pyramid:
             case Desert_Well:
-                if (biomeID == desert || isMesa(biomeID))
+                if (biomeID == desert || bpIs(bp, biomeID, BF_MESA))
                     return 0;
                 break;
             case Jungle_Pyramid:
@@ -1346,13 +1349,13 @@ static int mapViableBiome(const Layer * l, int * out, int x, int z, int w, int h
                     return 0;
                 break;
             case Treasure:
-                if (isOceanic(biomeID))
+                if (bpIs(bp, biomeID, BF_OCEANIC))
                     return 0;
                 break;
             case Ocean_Ruin:
             case Shipwreck:
             case Monument:
-                if (isOceanic(biomeID))
+                if (bpIs(bp, biomeID, BF_OCEANIC))
                     return 0;
                 break;
             case Mansion:
@@ -4468,6 +4471,14 @@ int floodFillGen(struct locate_info_t *info, int i, int j, Pos *p)
 
 int getBiomeCenters(Pos *pos, int *siz, int nmax, Generator *g, Range r,
     int match, int minsiz, int tol, volatile char *stop)
+{
+    return getBiomeCentersStats(pos, siz, nmax, g, r, match, minsiz, tol,
+        stop, NULL);
+}
+
+int getBiomeCentersStats(Pos *pos, int *siz, int nmax, Generator *g, Range r,
+    int match, int minsiz, int tol, volatile char *stop,
+    NoiseBoundStats *stats)
 {
     if (minsiz <= 0)
         minsiz = 1;
@@ -4514,8 +4525,17 @@ int getBiomeCenters(Pos *pos, int *siz, int nmax, Generator *g, Range r,
                     DoublePerlinNoise *dpn = &g->bn.climate[para[k]];
                     double px = (r.x+i) * r.scale / 4.0;
                     double pz = (r.z+j) * r.scale / 4.0;
-                    int p = 10000 * sampleDoublePerlin(dpn, px, 0, pz);
-                    if (p < plim[0] || p > plim[1])
+                    // decide with as few octaves as possible whether the
+                    // (truncated) parameter is well outside of the limits
+                    double v;
+                    int out = sampleDoublePerlinBounded(dpn, stats, px, 0, pz,
+                        (plim[0] - 1.0) / 10000, (plim[1] + 1.0) / 10000, &v);
+                    if (!out)
+                    {
+                        int p = 10000 * v;
+                        out = p < plim[0] || p > plim[1];
+                    }
+                    if (out)
                     {
                         ids[j*r.sx + i] = -2;
                         break;
@@ -651,6 +651,22 @@ int getBiomeCenters(
         volatile char * stop
         );
 
+/* Same as getBiomeCenters(), and additionally accumulates in 'stats' how
+ * many octaves the 1.18+ climate limit checks sampled and skipped.
+ */
+int getBiomeCentersStats(
+        Pos           * pos,
+        int           * siz,
+        int             nmax,
+        Generator     * g,
+        Range           r,
+        int             match,
+        int             minsiz,
+        int             tol,
+        volatile char * stop,
+        NoiseBoundStats * stats
+        );
+
 /* Checks if a biome may generate given a version and layer ID as entry point.
  * The supported layers are:
  * L_BIOME_256, L_BAMBOO_256, L_BIOME_EDGE_64, L_HILLS_64, L_SUNFLOWER_64,
@@ -6,6 +6,12 @@
 #include <string.h>
 #include <math.h>
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 
 int mapOceanMixMod(const Layer * l, int * out, int x, int z, int w, int h)
 {
@@ -18,6 +24,7 @@ int mapOceanMixMod(const Layer * l, int * out, int x, int z, int w, int h)
 
     l->p->getMap(l->p, out, x, z, w, h);
 
+    const BiomeProps *bp = getBiomeProps(l->mc);
 
     for (j = 0; j < h; j++)
     {
@@ -27,7 +34,7 @@ int mapOceanMixMod(const Layer * l, int * out, int x, int z, int w, int h)
 
             landID = out[j*w + i];
 
-            if (!isOceanic(landID))
+            if (!bpIs(bp, landID, BF_OCEANIC))
                 continue;
 
             oceanID = otyp[j*w + i];
@@ -137,6 +144,74 @@ void applySeed(Generator *g, int dim, uint64_t seed)
 }
 
 
+/// Moves a reference into the generator src over to the same place in dst
+static void *relocate(void *ptr, const Generator *src, Generator *dst)
+{
+    uintptr_t p = (uintptr_t) ptr;
+    uintptr_t s = (uintptr_t) src;
+    if (p < s || p >= s + sizeof(*src))
+        return ptr;
+    return (char*) dst + (p - s);
+}
+
+static void relocateLayer(Layer *l, const Generator *src, Generator *dst)
+{
+    l->noise = relocate(l->noise, src, dst);
+    l->data = relocate(l->data, src, dst);
+    l->p = (Layer*) relocate(l->p, src, dst);
+    l->p2 = (Layer*) relocate(l->p2, src, dst);
+}
+
+static void relocateDoublePerlin(DoublePerlinNoise *dpn,
+    const Generator *src, Generator *dst)
+{
+    dpn->octA.octaves = (PerlinNoise*) relocate(dpn->octA.octaves, src, dst);
+    dpn->octB.octaves = (PerlinNoise*) relocate(dpn->octB.octaves, src, dst);
+}
+
+void cloneGenerator(Generator *dst, const Generator *src)
+{
+    int i;
+    if (dst == src)
+        return;
+    memcpy(dst, src, sizeof(*dst));
+
+    if (src->mc >= MC_B1_8 && src->mc <= MC_1_17)
+    {
+        LayerStack *ls = &dst->ls;
+        for (i = 0; i < L_NUM; i++)
+            relocateLayer(&ls->layers[i], src, dst);
+        for (i = 0; i < (int) (sizeof(dst->xlayer) / sizeof(Layer)); i++)
+            relocateLayer(&dst->xlayer[i], src, dst);
+        ls->entry_1 = (Layer*) relocate(ls->entry_1, src, dst);
+        ls->entry_4 = (Layer*) relocate(ls->entry_4, src, dst);
+        ls->entry_16 = (Layer*) relocate(ls->entry_16, src, dst);
+        ls->entry_64 = (Layer*) relocate(ls->entry_64, src, dst);
+        ls->entry_256 = (Layer*) relocate(ls->entry_256, src, dst);
+        dst->entry = (Layer*) relocate(dst->entry, src, dst);
+    }
+    else if (src->mc >= MC_1_18)
+    {
+        for (i = 0; i < NP_MAX; i++)
+            relocateDoublePerlin(&dst->bn.climate[i], src, dst);
+    }
+    else
+    {
+        for (i = 0; i < 3; i++)
+        {
+            OctaveNoise *on = &dst->bnb.climate[i];
+            on->octaves = (PerlinNoise*) relocate(on->octaves, src, dst);
+        }
+    }
+
+    if (src->dim == DIM_NETHER && src->mc >= MC_1_16_1)
+    {
+        relocateDoublePerlin(&dst->nn.temperature, src, dst);
+        relocateDoublePerlin(&dst->nn.humidity, src, dst);
+    }
+}
+
+
 size_t getMinCacheSize(const Generator *g, int scale, int sx, int sy, int sz)
 {
     if (sy == 0)
@@ -235,6 +310,245 @@ int genBiomes(const Generator *g, int *cache, Range r)
     return err;
 }
 
+
+STRUCT(BiomeWorker)
+{
+    const Generator *g;
+    int *cache;
+    Range r;
+    const LayerTiling *tiling; // tiles of a layered generator, or slabs of
+    int rows;           // 'rows' along z
+    int slabs;          // slabs per y-level for hinted lookups, zero otherwise
+    int units;
+    int threads;
+    int id;
+    uint64_t *hints;    // the hint after each slab
+    int err;
+};
+
+/* Gets the part of the range that is generated as a unit and returns the
+ * offset of its output.
+ */
+static size_t getBiomeWorkerUnit(const BiomeWorker *w, int unit, Range *s)
+{
+    int k = 0;
+    *s = w->r;
+    if (w->slabs)
+    {   // a single y-level, so the slab is contiguous in the output
+        k = unit / w->slabs;
+        unit %= w->slabs;
+        s->y += k;
+        s->sy = 1;
+    }
+    s->z += unit * w->rows;
+    s->sz = w->r.sz - unit * w->rows;
+    if (s->sz > w->rows)
+        s->sz = w->rows;
+    return ((size_t)k * w->r.sz + unit * (size_t)w->rows) * w->r.sx;
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI genBiomesThread(LPVOID data)
+#else
+static void *genBiomesThread(void *data)
+#endif
+{
+    BiomeWorker *w = (BiomeWorker*) data;
+    const Range *r = &w->r;
+    size_t len;
+    int *buf;
+    int unit, k, j;
+
+    if (w->tiling)
+        len = getTileCacheSize(w->tiling);
+    else
+        len = getMinCacheSize(w->g, r->scale, r->sx,
+            w->slabs ? 1 : r->sy, w->rows);
+    buf = (int*) malloc(len * sizeof(int));
+    if (!buf)
+    {
+        w->err = 1;
+        return 0;
+    }
+
+    // the units are interleaved over the threads, which balances the load
+    // well enough when there are several units per thread
+    for (unit = w->id; unit < w->units && !w->err; unit += w->threads)
+    {
+        if (w->tiling)
+        {
+            w->err = genAreaTile(w->tiling, w->cache, buf, unit);
+            continue;
+        }
+        Range s;
+        size_t off = getBiomeWorkerUnit(w, unit, &s);
+        if (w->slabs)
+        {
+            w->hints[unit] = 0;
+            w->err = genBiomeNoiseHinted(&w->g->bn, buf, s, &w->hints[unit]);
+            if (!w->err)
+                memcpy(w->cache + off, buf, s.sx * (size_t)s.sz * sizeof(int));
+            continue;
+        }
+        w->err = genBiomes(w->g, buf, s);
+        if (w->err)
+            continue;
+        for (k = 0; k < s.sy; k++)
+        {
+            for (j = 0; j < s.sz; j++)
+            {
+                memcpy(w->cache + off + ((size_t)k * r->sz + j) * r->sx,
+                    buf + ((size_t)k * s.sz + j) * s.sx, s.sx * sizeof(int));
+            }
+        }
+    }
+    free(buf);
+    return 0;
+}
+
+int genBiomesParallel(const Generator *g, int *cache, Range r, int threads)
+{
+    enum { UNITS_PER_THREAD = 4 };
+    BiomeWorker *w = NULL;
+    LayerTiling tiling;
+    uint64_t *hints = NULL;
+    int err = 0;
+    int64_t i, k;
+    int t;
+
+    if (r.sy == 0)
+        r.sy = 1;
+    if (threads > r.sx * (int64_t) r.sz * r.sy / 4096)
+        threads = (int) (r.sx * (int64_t) r.sz * r.sy / 4096);
+    if (g->dim == DIM_NETHER)
+        threads = 1; // the 3D fill of mapNether3D() depends on the range
+    if (threads <= 1)
+        return genBiomes(g, cache, r);
+
+    BiomeWorker job;
+    memset(&job, 0, sizeof(job));
+    job.g = g;
+    job.cache = cache;
+    job.r = r;
+    job.threads = threads;
+
+    if (g->dim == DIM_OVERWORLD && g->mc >= MC_B1_8 && g->mc <= MC_1_17)
+    {   // tiles of the 2D layer area, with smaller tiles for more units
+        const Layer *entry = getLayerForScale(g, r.scale);
+        if (!entry) return -1;
+        // the biome tables of the layers are built on first use, which
+        // happens here so that the workers only read them
+        getBiomeProps(g->mc);
+        int tileSize = 0;
+        for (;;)
+        {
+            setupLayerTiling(&tiling, entry, r.x, r.z, r.sx, r.sz, tileSize);
+            if (tiling.nx * tiling.nz >= UNITS_PER_THREAD * threads ||
+                (tiling.tw <= LAYER_TILE_MIN && tiling.th <= LAYER_TILE_MIN))
+                break;
+            tileSize = (tiling.tw > tiling.th ? tiling.tw : tiling.th) / 2;
+        }
+        job.tiling = &tiling;
+        job.units = tiling.nx * tiling.nz;
+    }
+    else
+    {
+        // hinted lookups (MC-241546) use slabs of single y-levels that are
+        // joined in the order of the output
+        int hinted = g->dim == DIM_OVERWORLD && g->mc >= MC_1_18 && r.scale > 4;
+        int levels = hinted ? r.sy : 1;
+        int slabs = (UNITS_PER_THREAD * threads + levels - 1) / levels;
+        if (slabs > r.sz)
+            slabs = r.sz;
+        job.rows = (r.sz + slabs - 1) / slabs;
+        slabs = (r.sz + job.rows - 1) / job.rows;
+        job.units = slabs * levels;
+        if (hinted)
+        {
+            job.slabs = slabs;
+            hints = (uint64_t*) malloc(job.units * sizeof(uint64_t));
+            if (!hints) return 1;
+            job.hints = hints;
+        }
+    }
+
+    w = (BiomeWorker*) malloc(threads * sizeof(BiomeWorker));
+    if (!w)
+    {
+        free(hints);
+        return 1;
+    }
+    for (t = 0; t < threads; t++)
+    {
+        w[t] = job;
+        w[t].id = t;
+    }
+
+#if defined(_WIN32)
+    HANDLE *tids = (HANDLE*) malloc(threads * sizeof(HANDLE));
+    if (tids)
+    {
+        int nt = 0;
+        for (t = 0; t < threads; t++)
+        {   // a worker that did not get a thread does its units here instead
+            tids[nt] = CreateThread(NULL, 0, genBiomesThread, &w[t], 0, NULL);
+            if (tids[nt])
+                nt++;
+            else
+                genBiomesThread(&w[t]);
+        }
+        if (nt)
+            WaitForMultipleObjects(nt, tids, TRUE, INFINITE);
+        for (t = 0; t < nt; t++)
+            CloseHandle(tids[t]);
+    }
+#else
+    pthread_t *tids = (pthread_t*) malloc(threads * sizeof(pthread_t));
+    if (tids)
+    {
+        int nt = 0;
+        for (t = 0; t < threads; t++)
+        {   // a worker that did not get a thread does its units here instead
+            if (pthread_create(&tids[nt], NULL, genBiomesThread, &w[t]) == 0)
+                nt++;
+            else
+                genBiomesThread(&w[t]);
+        }
+        for (t = 0; t < nt; t++)
+            pthread_join(tids[t], NULL);
+    }
+#endif
+    if (!tids)
+        err = 1;
+    free(tids);
+    for (t = 0; t < threads && !err; t++)
+        err = w[t].err;
+    free(w);
+
+    if (!err && hints)
+    {   // the slabs were generated from the hint zero and are corrected in
+        // order with the hint of their predecessor
+        uint64_t dat = hints[0];
+        Range s;
+        for (t = 1; t < job.units; t++)
+        {
+            size_t off = getBiomeWorkerUnit(&job, t, &s);
+            dat = fixBiomeNoiseHint(&g->bn, cache + off, s, dat, hints[t]);
+        }
+    }
+    free(hints);
+
+    if (!err && job.tiling)
+    {
+        for (k = 1; k < r.sy; k++)
+        {   // overworld has no vertical noise: expanding 2D into 3D
+            for (i = 0; i < r.sx*r.sz; i++)
+                cache[k*r.sx*r.sz + i] = cache[i];
+        }
+    }
+    return err;
+}
+
 int getBiomeAt(const Generator *g, int scale, int x, int y, int z)
 {
     Range r = {scale, x, z, 1, 1, y, 1};
@@ -600,12 +914,83 @@ size_t getMinLayerCacheSize(const Layer *layer, int sizeX, int sizeZ)
     return bufsiz + maxX * (size_t)maxZ;
 }
 
-int genArea(const Layer *layer, int *out, int areaX, int areaZ, int areaWidth, int areaHeight)
+static int genAreaFull(const Layer *layer, int *out,
+    int areaX, int areaZ, int areaWidth, int areaHeight)
 {
     memset(out, 0, sizeof(*out)*areaWidth*areaHeight);
     return layer->getMap(layer, out, areaX, areaZ, areaWidth, areaHeight);
 }
 
+int genArea(const Layer *layer, int *out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    size_t area = areaWidth * (size_t)areaHeight;
+    size_t len = getMinLayerCacheSize(layer, areaWidth, areaHeight);
+
+    if (len * sizeof(int) > LAYER_TILE_CACHE)
+    {   // the tiles use the remainder of the buffer as their cache
+        LayerTiling t;
+        setupLayerTiling(&t, layer, areaX, areaZ, areaWidth, areaHeight, 0);
+        int i, n = t.nx * t.nz;
+        if (n > 1 && area + getTileCacheSize(&t) <= len)
+        {
+            for (i = 0; i < n; i++)
+            {
+                int err = genAreaTile(&t, out, out + area, i);
+                if (err)
+                    return err;
+            }
+            return 0;
+        }
+    }
+    return genAreaFull(layer, out, areaX, areaZ, areaWidth, areaHeight);
+}
+
+void setupLayerTiling(LayerTiling *t, const Layer *layer,
+    int areaX, int areaZ, int areaWidth, int areaHeight, int tileSize)
+{
+    if (tileSize <= 0)
+    {   // the buffers of a tile include the margins of all the layers
+        tileSize = LAYER_TILE_MAX;
+        while (tileSize > LAYER_TILE_MIN &&
+            getMinLayerCacheSize(layer, tileSize, tileSize) * sizeof(int)
+                > LAYER_TILE_CACHE)
+        {
+            tileSize >>= 1;
+        }
+    }
+    t->layer = layer;
+    t->x = areaX;
+    t->z = areaZ;
+    t->w = areaWidth;
+    t->h = areaHeight;
+    t->tw = tileSize < areaWidth ? tileSize : areaWidth;
+    t->th = tileSize < areaHeight ? tileSize : areaHeight;
+    t->nx = (areaWidth + t->tw - 1) / t->tw;
+    t->nz = (areaHeight + t->th - 1) / t->th;
+}
+
+size_t getTileCacheSize(const LayerTiling *t)
+{
+    return getMinLayerCacheSize(t->layer, t->tw, t->th);
+}
+
+int genAreaTile(const LayerTiling *t, int *out, int *cache, int tile)
+{
+    int i = (tile % t->nx) * t->tw;
+    int j = (tile / t->nx) * t->th;
+    int w = t->w - i < t->tw ? t->w - i : t->tw;
+    int h = t->h - j < t->th ? t->h - j : t->th;
+    int k;
+
+    int err = genAreaFull(t->layer, cache, t->x + i, t->z + j, w, h);
+    if (err)
+        return err;
+    for (k = 0; k < h; k++)
+        memcpy(out + (j + k) * (size_t)t->w + i, cache + k * (size_t)w,
+            w * sizeof(int));
+    return 0;
+}
+
 
 int mapApproxHeight(float *y, int *ids, const Generator *g, const SurfaceNoise *sn,
     int x, int z, int w, int h)
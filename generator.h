@@ -34,8 +34,10 @@ STRUCT(Generator)
             //SurfaceNoiseBeta snb;
         };
     };
-    NetherNoise nn; // MC 1.16
-    EndNoise en; // MC 1.9
+    union { // state of the last applied dimension other than the overworld
+        NetherNoise nn; // MC 1.16
+        EndNoise en; // MC 1.9
+    };
 };
 
 
@@ -63,6 +65,17 @@ void setupGenerator(Generator *g, int mc, uint32_t flags);
  */
 void applySeed(Generator *g, int dim, uint64_t seed);
 
+/**
+ * Copies the generator 'src' into 'dst', so that both can be used
+ * independently afterwards. This is a memcpy() with the internal references
+ * moved over to the copy, which makes it much cheaper than setting up a new
+ * generator when many instances are needed (e.g. one per thread or job): a
+ * template can be set up (and seeded) once and then stamped out.
+ * Custom layers are copied as they are and keep referring to any external
+ * data of the template.
+ */
+void cloneGenerator(Generator *dst, const Generator *src);
+
 /**
  * Calculates the buffer size (number of ints) required to generate a cuboidal
  * volume of size (sx, sy, sz). If 'sy' is zero the buffer is calculated for a
@@ -87,6 +100,24 @@ int *allocCache(const Generator *g, Range r);
  * The return value is zero upon success.
  */
 int genBiomes(const Generator *g, int *cache, Range r);
+
+/**
+ * Multithreaded variant of genBiomes() for large ranges, with the same
+ * buffer requirements and output. The range is split into parts that are
+ * generated on up to 'threads' threads, each with its own scratch buffer,
+ * while the seeded generator is shared and must not change in the meantime.
+ * Layered versions (Beta 1.8 - 1.17) distribute tiles of the layer area (see
+ * LayerTiling) and the others slabs along z. The nether is generated on the
+ * calling thread, since the biomes that mapNether3D() fills in around its
+ * samples depend on the extent of the range.
+ *
+ * At scales above 1:4, the 1.18+ biome lookups depend on the previous biome
+ * in the order of the output (MC-241546, see genBiomeNoiseHinted()). Here the
+ * slabs contain a single y-level and are generated from the default hint,
+ * after which the first biomes of each slab are redone, in order, from the
+ * hint where the preceding slab ended, until they agree.
+ */
+int genBiomesParallel(const Generator *g, int *cache, Range r, int threads);
 /**
  * Gets the biome for a specified scaled position. Note that the scale should
  * be either 1 or 4, for block or biome coordinates respectively.
@@ -127,6 +158,41 @@ Layer *setupLayer(Layer *l, mapfunc_t *map, int mc,
  */
 int genArea(const Layer *layer, int *out, int areaX, int areaZ, int areaWidth, int areaHeight);
 
+/* Tiled generation of large areas.
+ * The layers are evaluated over the whole requested area, one after another,
+ * so for large areas the intermediate buffers no longer fit into the cache.
+ * A tiling instead runs the whole layer chain on tiles of the area, where
+ * each tile generates its own margin from the edges and zooms of the layers.
+ * genArea() does this automatically for areas that are large enough to
+ * benefit, with the results unchanged.
+ *
+ * The tiles can also be generated independently, e.g. distributed over
+ * threads, as long as each worker has its own 'cache' buffer of at least
+ * getTileCacheSize() ints. The tile writes its part of the area to 'out',
+ * indexed as in genArea(). A 'tileSize' of zero chooses a size for which
+ * the buffers of a tile fit into the cache.
+ */
+enum
+{   // Budget for getMinLayerCacheSize() of a tile in bytes. It counts the
+    // buffers of all the layers, of which only a few are in use at a time.
+    LAYER_TILE_CACHE    = 8 << 20,
+    LAYER_TILE_MIN      = 64,           // bounds of the automatic tile size
+    LAYER_TILE_MAX      = 512,
+};
+
+STRUCT(LayerTiling)
+{
+    const Layer *layer;
+    int x, z, w, h;     // area
+    int tw, th;         // tile size
+    int nx, nz;         // number of tiles along x and z
+};
+
+void setupLayerTiling(LayerTiling *t, const Layer *layer,
+    int areaX, int areaZ, int areaWidth, int areaHeight, int tileSize);
+size_t getTileCacheSize(const LayerTiling *t);
+int genAreaTile(const LayerTiling *t, int *out, int *cache, int tile);
+
 /**
  * Map an approximation of the Overworld surface height.
  * The horizontal scaling is 1:4. If non-null, the ids are filled with the
@@ -5,6 +5,125 @@
 #include <math.h>
 #include <float.h>
 
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define LAYER_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#if LAYER_SIMD_X86
+
+/* Helpers for the SIMD kernels of the layers. The 64-bit layer PRNG needs the
+ * AVX-512 multiplies, so the kernels that draw chunk seeds require AVX-512,
+ * while those that only compare cell values make do with AVX2.
+ */
+#define AVX512_LAYER "avx512f,avx512dq,avx512vl"
+
+#define SHALLOW_OCEAN_BITS ( \
+    (1ULL << ocean) | (1ULL << frozen_ocean) | (1ULL << warm_ocean) | \
+    (1ULL << lukewarm_ocean) | (1ULL << cold_ocean))
+#define DEEP_OCEAN_BITS ( \
+    (1ULL << deep_ocean) | (1ULL << deep_frozen_ocean) | \
+    (1ULL << deep_warm_ocean) | (1ULL << deep_lukewarm_ocean) | \
+    (1ULL << deep_cold_ocean))
+
+ATTR(target(AVX512_LAYER))
+static inline __m512i stepSeedAVX512(__m512i s, __m512i salt)
+{
+    const __m512i m = _mm512_set1_epi64(6364136223846793005LL);
+    const __m512i a = _mm512_set1_epi64(1442695040888963407LL);
+    __m512i t = _mm512_add_epi64(_mm512_mullo_epi64(s, m), a);
+    return _mm512_add_epi64(_mm512_mullo_epi64(s, t), salt);
+}
+
+ATTR(target(AVX512_LAYER))
+static inline __m512i chunkSeedAVX512(__m512i ss, int x, int z)
+{
+    __m512i vx = _mm512_set1_epi64(x);
+    __m512i vz = _mm512_set1_epi64(z);
+    __m512i cs = _mm512_add_epi64(ss, vx);
+    cs = stepSeedAVX512(cs, vz);
+    cs = stepSeedAVX512(cs, vx);
+    cs = stepSeedAVX512(cs, vz);
+    return cs;
+}
+
+/// Chunk seeds of the cells (x+0, z) ... (x+7, z) for a single layer seed.
+ATTR(target(AVX512_LAYER))
+static inline __m512i chunkSeedRowAVX512(uint64_t ss, int x, int z)
+{
+    __m512i vx = _mm512_add_epi64(_mm512_set1_epi64(x),
+        _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i vz = _mm512_set1_epi64(z);
+    __m512i cs = _mm512_add_epi64(_mm512_set1_epi64(ss), vx);
+    cs = stepSeedAVX512(cs, vz);
+    cs = stepSeedAVX512(cs, vx);
+    cs = stepSeedAVX512(cs, vz);
+    return cs;
+}
+
+/// mcFirstInt(): the shifted seed has 40 significant bits, so the floored
+/// division is exact in double precision, except that the rounding of the
+/// reciprocal can move the quotient by one, which is corrected afterwards.
+ATTR(target(AVX512_LAYER))
+static inline __m512d firstIntAVX512(__m512i s, int mod)
+{
+    const __m512d m = _mm512_set1_pd(mod);
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d v = _mm512_cvtepi64_pd(_mm512_srai_epi64(s, 24));
+    __m512d q = _mm512_mul_pd(v, _mm512_set1_pd(1.0 / mod));
+    q = _mm512_roundscale_pd(q, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    __m512d r = _mm512_fnmadd_pd(q, m, v);
+    r = _mm512_mask_add_pd(r, _mm512_cmp_pd_mask(r, zero, _CMP_LT_OQ), r, m);
+    r = _mm512_mask_sub_pd(r, _mm512_cmp_pd_mask(r, m, _CMP_GE_OQ), r, m);
+    return r;
+}
+
+// Powers of two only need the low bits of the shifted seed.
+ATTR(target(AVX512_LAYER))
+static inline __m256i firstIntAVX512i(__m512i s, int mod)
+{
+    if ((mod & (mod - 1)) == 0)
+    {
+        __m256i v = _mm512_cvtepi64_epi32(_mm512_srli_epi64(s, 24));
+        return _mm256_and_si256(v, _mm256_set1_epi32(mod - 1));
+    }
+    return _mm512_cvtpd_epi32(firstIntAVX512(s, mod));
+}
+
+ATTR(target(AVX512_LAYER))
+static inline __mmask8 firstIsZeroAVX512(__m512i s, int mod)
+{
+    if ((mod & (mod - 1)) == 0)
+        return _mm512_testn_epi64_mask(s, _mm512_set1_epi64((mod - 1LL) << 24));
+    return _mm512_cmp_pd_mask(firstIntAVX512(s, mod), _mm512_setzero_pd(),
+        _CMP_EQ_OQ);
+}
+
+/// Lanes with (uint32_t) id < 64 && (bits >> id) & 1, where the variable
+/// shifts give zero for counts of 32 and more.
+ATTR(target(AVX512_LAYER))
+static inline __mmask8 isAnyOfAVX512(__m256i id, uint64_t bits)
+{
+    __m256i lo = _mm256_srlv_epi32(_mm256_set1_epi32((uint32_t) bits), id);
+    __m256i hi = _mm256_srlv_epi32(_mm256_set1_epi32((uint32_t)(bits >> 32)),
+        _mm256_sub_epi32(id, _mm256_set1_epi32(32)));
+    return _mm256_test_epi32_mask(_mm256_or_si256(lo, hi), _mm256_set1_epi32(1));
+}
+
+/// As isAnyOfAVX512(), but as a vector mask for AVX2.
+ATTR(target("avx2"))
+static inline __m256i isAnyOfAVX2(__m256i id, uint64_t bits)
+{
+    __m256i lo = _mm256_srlv_epi32(_mm256_set1_epi32((uint32_t) bits), id);
+    __m256i hi = _mm256_srlv_epi32(_mm256_set1_epi32((uint32_t)(bits >> 32)),
+        _mm256_sub_epi32(id, _mm256_set1_epi32(32)));
+    __m256i one = _mm256_set1_epi32(1);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_or_si256(lo, hi), one), one);
+}
+
+#endif // LAYER_SIMD_X86
+
 
 //==============================================================================
 // Essentials
@@ -82,6 +201,100 @@ int mapContinent(const Layer * l, int * out, int x, int z, int w, int h)
     return 0;
 }
 
+#if LAYER_SIMD_X86
+
+/* A row of mapZoom() or mapZoomFuzzy() for 8 parent cells at a time, with
+ * the chunk seeds vectorised across x. Writes the two output rows b0 and b1
+ * and returns the number of parent cells that were done.
+ */
+ATTR(target("avx2"))
+static int64_t mapZoomRowAVX2(const int *p0, const int *p1, int *b0, int *b1,
+        int64_t pW, int chunkX, int chunkZ, uint32_t ss, uint32_t st, int fuzzy)
+{
+    const __m256i mul = _mm256_set1_epi32(1284865837);
+    const __m256i add = _mm256_set1_epi32((int)4150755663U);
+    const __m256i bit24 = _mm256_set1_epi32(1 << 24);
+    const __m256i bit25 = _mm256_set1_epi32(1 << 25);
+    const __m256i vst = _mm256_set1_epi32(st);
+    const __m256i cz = _mm256_set1_epi32(chunkZ);
+    const __m256i dx = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    int64_t i;
+
+#define ZOOM_STEP(cs) \
+    _mm256_mullo_epi32(cs, _mm256_add_epi32(_mm256_mullo_epi32(cs, mul), add))
+#define ZOOM_BIT(cs, bit) \
+    _mm256_cmpeq_epi32(_mm256_and_si256(cs, bit), bit)
+
+    // the last cell reads one past the 8, so it has to stay within the row
+    for (i = 0; i + 8 < pW; i += 8)
+    {
+        __m256i v00 = _mm256_loadu_si256((const __m256i*)(p0 + i));
+        __m256i v10 = _mm256_loadu_si256((const __m256i*)(p0 + i + 1));
+        __m256i v01 = _mm256_loadu_si256((const __m256i*)(p1 + i));
+        __m256i v11 = _mm256_loadu_si256((const __m256i*)(p1 + i + 1));
+        __m256i a, b, c, d, m;
+
+        __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi32(v00, v10),
+            _mm256_and_si256(_mm256_cmpeq_epi32(v00, v01),
+                             _mm256_cmpeq_epi32(v00, v11)));
+        if (_mm256_movemask_epi8(eq) == -1)
+        {
+            a = b = c = d = v00;
+        }
+        else
+        {
+            __m256i cx = _mm256_add_epi32(_mm256_set1_epi32(chunkX + 2*(int)i), dx);
+            __m256i cs = _mm256_add_epi32(_mm256_set1_epi32(ss), cx);
+            cs = _mm256_add_epi32(ZOOM_STEP(cs), cz);
+            cs = _mm256_add_epi32(ZOOM_STEP(cs), cx);
+            cs = _mm256_add_epi32(ZOOM_STEP(cs), cz);
+
+            a = v00;
+            c = _mm256_blendv_epi8(v00, v01, ZOOM_BIT(cs, bit24));
+
+            cs = _mm256_add_epi32(ZOOM_STEP(cs), vst);
+            b = _mm256_blendv_epi8(v00, v10, ZOOM_BIT(cs, bit24));
+
+            cs = _mm256_add_epi32(ZOOM_STEP(cs), vst);
+            m = ZOOM_BIT(cs, bit24);
+            d = _mm256_blendv_epi8(
+                _mm256_blendv_epi8(v00, v10, m),
+                _mm256_blendv_epi8(v01, v11, m), ZOOM_BIT(cs, bit25));
+
+            if (!fuzzy)
+            {   // select4(), with the negated counts of equal neighbours
+                __m256i c00 = _mm256_add_epi32(_mm256_add_epi32(
+                    _mm256_cmpeq_epi32(v00, v10), _mm256_cmpeq_epi32(v00, v01)),
+                    _mm256_cmpeq_epi32(v00, v11));
+                __m256i c10 = _mm256_add_epi32(
+                    _mm256_cmpeq_epi32(v10, v01), _mm256_cmpeq_epi32(v10, v11));
+                __m256i c01 = _mm256_cmpeq_epi32(v01, v11);
+                __m256i s00 = _mm256_and_si256(_mm256_cmpgt_epi32(c10, c00),
+                    _mm256_cmpgt_epi32(c01, c00));
+                d = _mm256_blendv_epi8(d, v01, _mm256_cmpgt_epi32(c00, c01));
+                d = _mm256_blendv_epi8(d, v10, _mm256_cmpgt_epi32(c00, c10));
+                d = _mm256_blendv_epi8(d, v00, s00);
+            }
+        }
+
+        // interleave the two columns of each output row
+        __m256i lo = _mm256_unpacklo_epi32(a, b);
+        __m256i hi = _mm256_unpackhi_epi32(a, b);
+        _mm256_storeu_si256((__m256i*)(b0 + 2*i + 0), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(b0 + 2*i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+        lo = _mm256_unpacklo_epi32(c, d);
+        hi = _mm256_unpackhi_epi32(c, d);
+        _mm256_storeu_si256((__m256i*)(b1 + 2*i + 0), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(b1 + 2*i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+#undef ZOOM_STEP
+#undef ZOOM_BIT
+
+    return i;
+}
+
+#endif // LAYER_SIMD_X86
+
 int mapZoomFuzzy(const Layer * l, int * out, int x, int z, int w, int h)
 {
     int pX = x >> 1;
@@ -102,15 +315,27 @@ int mapZoomFuzzy(const Layer * l, int * out, int x, int z, int w, int h)
 
     const uint32_t st = (uint32_t)l->startSalt;
     const uint32_t ss = (uint32_t)l->startSeed;
+#if LAYER_SIMD_X86
+    int avx2 = __builtin_cpu_supports("avx2");
+#endif
 
     for (j = 0; j < pH; j++)
     {
         idx = (j * 2) * newW;
+        i = 0;
+#if LAYER_SIMD_X86
+        if (avx2)
+        {
+            i = mapZoomRowAVX2(out + j*pW, out + (j+1)*pW, buf + idx,
+                buf + idx + newW, pW, pX*2, (j + pZ)*2, ss, st, 1);
+            idx += 2*i;
+        }
+#endif
 
-        v00 = out[(j+0)*pW];
-        v01 = out[(j+1)*pW];
+        v00 = out[i + (j+0)*pW];
+        v01 = out[i + (j+1)*pW];
 
-        for (i = 0; i < pW; i++, v00 = v10, v01 = v11)
+        for (; i < pW; i++, v00 = v10, v01 = v11)
         {
             v10 = out[i+1 + (j+0)*pW];
             v11 = out[i+1 + (j+1)*pW];
@@ -206,15 +431,27 @@ int mapZoom(const Layer * l, int * out, int x, int z, int w, int h)
 
     const uint32_t st = (uint32_t)l->startSalt;
     const uint32_t ss = (uint32_t)l->startSeed;
+#if LAYER_SIMD_X86
+    int avx2 = __builtin_cpu_supports("avx2");
+#endif
 
     for (j = 0; j < pH; j++)
     {
         idx = (j * 2) * newW;
+        i = 0;
+#if LAYER_SIMD_X86
+        if (avx2)
+        {
+            i = mapZoomRowAVX2(out + j*pW, out + (j+1)*pW, buf + idx,
+                buf + idx + newW, pW, pX*2, (j + pZ)*2, ss, st, 0);
+            idx += 2*i;
+        }
+#endif
 
-        v00 = out[(j+0)*pW];
-        v01 = out[(j+1)*pW];
+        v00 = out[i + (j+0)*pW];
+        v01 = out[i + (j+1)*pW];
 
-        for (i = 0; i < pW; i++, v00 = v10, v01 = v11)
+        for (; i < pW; i++, v00 = v10, v01 = v11)
         {
             v10 = out[i+1 + (j+0)*pW];
             v11 = out[i+1 + (j+1)*pW];
@@ -614,6 +851,7 @@ int mapSnow(const Layer * l, int * out, int x, int z, int w, int h)
     if unlikely(err != 0)
         return err;
 
+    const BiomeProps *bp = getBiomeProps(l->mc);
     uint64_t ss = l->startSeed;
     uint64_t cs;
 
@@ -622,7 +860,7 @@ int mapSnow(const Layer * l, int * out, int x, int z, int w, int h)
         for (i = 0; i < w; i++)
         {
             int v11 = out[i+1 + (j+1)*pW];
-            if (!isShallowOcean(v11))
+            if (!bpIs(bp, v11, BF_SHALLOW))
             {
                 cs = getChunkSeed(ss, i+x, j+z);
                 int r = mcFirstInt(cs, 6);
@@ -801,20 +1039,22 @@ int mapDeepOcean(const Layer * l, int * out, int x, int z, int w, int h)
     if unlikely(err != 0)
         return err;
 
+    const BiomeProps *bp = getBiomeProps(l->mc);
+
     for (j = 0; j < h; j++)
     {
         for (i = 0; i < w; i++)
         {
             int v11 = out[(i+1) + (j+1)*pW];
 
-            if (isShallowOcean(v11))
+            if (bpIs(bp, v11, BF_SHALLOW))
             {
                 // count adjacent oceans
                 int oceans = 0;
-                if (isShallowOcean(out[(i+1) + (j+0)*pW])) oceans++;
-                if (isShallowOcean(out[(i+2) + (j+1)*pW])) oceans++;
-                if (isShallowOcean(out[(i+0) + (j+1)*pW])) oceans++;
-                if (isShallowOcean(out[(i+1) + (j+2)*pW])) oceans++;
+                if (bpIs(bp, out[(i+1) + (j+0)*pW], BF_SHALLOW)) oceans++;
+                if (bpIs(bp, out[(i+2) + (j+1)*pW], BF_SHALLOW)) oceans++;
+                if (bpIs(bp, out[(i+0) + (j+1)*pW], BF_SHALLOW)) oceans++;
+                if (bpIs(bp, out[(i+1) + (j+2)*pW], BF_SHALLOW)) oceans++;
 
                 if (oceans >= 4)
                 {
@@ -866,6 +1106,7 @@ int mapBiome(const Layer * l, int * out, int x, int z, int w, int h)
         return err;
 
     int mc = l->mc;
+    const BiomeProps *bp = getBiomeProps(mc);
     uint64_t ss = l->startSeed;
     uint64_t cs;
 
@@ -899,7 +1140,7 @@ int mapBiome(const Layer * l, int * out, int x, int z, int w, int h)
             }
             else
             {
-                if (isOceanic(id) || id == mushroom_fields)
+                if (bpIs(bp, id, BF_OCEANIC) || id == mushroom_fields)
                 {
                     out[idx] = id;
                     continue;
@@ -998,12 +1239,12 @@ int mapBamboo(const Layer * l, int * out, int x, int z, int w, int h)
 }
 
 
-static inline int replaceEdge(int *out, int idx, int mc, int v10, int v21, int v01, int v12, int id, int baseID, int edgeID)
+static inline int replaceEdge(int *out, int idx, const BiomeProps *bp, int v10, int v21, int v01, int v12, int id, int baseID, int edgeID)
 {
     if (id != baseID) return 0;
 
-    if (areSimilar(mc, v10, baseID) && areSimilar(mc, v21, baseID) &&
-        areSimilar(mc, v01, baseID) && areSimilar(mc, v12, baseID))
+    if (bpSimilar(bp, v10, baseID) && bpSimilar(bp, v21, baseID) &&
+        bpSimilar(bp, v01, baseID) && bpSimilar(bp, v12, baseID))
         out[idx] = id;
     else
         out[idx] = edgeID;
@@ -1012,6 +1253,99 @@ static inline int replaceEdge(int *out, int idx, int mc, int v10, int v21, int v
 }
 
 
+static inline void mapBiomeEdgeCell(int *out, const BiomeProps *bp,
+        int v11, int v10, int v21, int v01, int v12)
+{
+    if (!replaceEdge(out, 0, bp, v10, v21, v01, v12, v11, wooded_badlands_plateau, badlands) &&
+        !replaceEdge(out, 0, bp, v10, v21, v01, v12, v11, badlands_plateau, badlands) &&
+        !replaceEdge(out, 0, bp, v10, v21, v01, v12, v11, giant_tree_taiga, taiga))
+    {
+        if (v11 == desert)
+        {
+            if (!isAny4(snowy_tundra, v10, v21, v01, v12))
+            {
+                *out = v11;
+            }
+            else
+            {
+                *out = wooded_mountains;
+            }
+        }
+        else if (v11 == swamp)
+        {
+            if (!isAny4(desert, v10, v21, v01, v12) &&
+                !isAny4(snowy_taiga, v10, v21, v01, v12) &&
+                !isAny4(snowy_tundra, v10, v21, v01, v12))
+            {
+                if (!isAny4(jungle, v10, v21, v01, v12) &&
+                    !isAny4(bamboo_jungle, v10, v21, v01, v12))
+                    *out = v11;
+                else
+                    *out = jungle_edge;
+            }
+            else
+            {
+                *out = plains;
+            }
+        }
+        else
+        {
+            *out = v11;
+        }
+    }
+}
+
+#if LAYER_SIMD_X86
+
+/* Loads the centres of 8 cells in a row of a 3x3 layer and returns the bit
+ * mask of the cells whose four direct neighbours all equal their centre.
+ * Most layers leave these cells unchanged, so only the others need the
+ * scalar code.
+ */
+ATTR(target("avx2"))
+static inline int loadCrossAVX2(const int *vz0, const int *vz1, const int *vz2,
+        __m256i *v11)
+{
+    __m256i c = _mm256_loadu_si256((const __m256i*)(vz1 + 1));
+    __m256i eq = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_cmpeq_epi32(c, _mm256_loadu_si256((const __m256i*)(vz0 + 1))),
+            _mm256_cmpeq_epi32(c, _mm256_loadu_si256((const __m256i*)(vz2 + 1)))),
+        _mm256_and_si256(
+            _mm256_cmpeq_epi32(c, _mm256_loadu_si256((const __m256i*)(vz1 + 0))),
+            _mm256_cmpeq_epi32(c, _mm256_loadu_si256((const __m256i*)(vz1 + 2)))));
+    *v11 = c;
+    return _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+}
+
+ATTR(target("avx2"))
+static int64_t mapBiomeEdgeRowAVX2(int *out, const BiomeProps *bp,
+        const int *vz0, const int *vz1, const int *vz2, int64_t w)
+{
+    int64_t i;
+    int k;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        __m256i v11;
+        int t[8];
+        int m = loadCrossAVX2(vz0 + i, vz1 + i, vz2 + i, &v11);
+        _mm256_storeu_si256((__m256i*) t, v11);
+        for (k = 0; k < 8; k++)
+        {
+            if (m >> k & 1)
+                continue;
+            mapBiomeEdgeCell(t + k, bp, vz1[i+k+1],
+                vz0[i+k+1], vz1[i+k+2], vz1[i+k+0], vz2[i+k+1]);
+        }
+        // the cells are only written back once their neighbours were read
+        memcpy(out + i, t, sizeof(t));
+    }
+    return i;
+}
+
+#endif // LAYER_SIMD_X86
+
 int mapBiomeEdge(const Layer * l, int * out, int x, int z, int w, int h)
 {
     int pX = x - 1;
@@ -1019,19 +1353,28 @@ int mapBiomeEdge(const Layer * l, int * out, int x, int z, int w, int h)
     int64_t pW = w + 2;
     int64_t pH = h + 2;
     int64_t i, j;
-    int mc = l->mc;
+    const BiomeProps *bp = getBiomeProps(l->mc);
 
     int err = l->p->getMap(l->p, out, pX, pZ, pW, pH);
     if unlikely(err != 0)
         return err;
 
+#if LAYER_SIMD_X86
+    int avx2 = __builtin_cpu_supports("avx2");
+#endif
+
     for (j = 0; j < h; j++)
     {
         int *vz0 = out + (j+0)*pW;
         int *vz1 = out + (j+1)*pW;
         int *vz2 = out + (j+2)*pW;
 
-        for (i = 0; i < w; i++)
+        i = 0;
+#if LAYER_SIMD_X86
+        if (avx2)
+            i = mapBiomeEdgeRowAVX2(out + j*w, bp, vz0, vz1, vz2, w);
+#endif
+        for (; i < w; i++)
         {
             int v11 = vz1[i+1];
             int v10 = vz0[i+1];
@@ -1039,49 +1382,175 @@ int mapBiomeEdge(const Layer * l, int * out, int x, int z, int w, int h)
             int v01 = vz1[i+0];
             int v12 = vz2[i+1];
 
-            if (!replaceEdge(out, i + j*w, mc, v10, v21, v01, v12, v11, wooded_badlands_plateau, badlands) &&
-                !replaceEdge(out, i + j*w, mc, v10, v21, v01, v12, v11, badlands_plateau, badlands) &&
-                !replaceEdge(out, i + j*w, mc, v10, v21, v01, v12, v11, giant_tree_taiga, taiga))
+            mapBiomeEdgeCell(out + i + j*w, bp, v11, v10, v21, v01, v12);
+        }
+    }
+
+    return 0;
+}
+
+
+/// Hills of the cell at a11 = pa[0], with the parent row width pW.
+static inline int mapHillsCell(int mc, const BiomeProps *bp,
+        uint64_t st, uint64_t ss, int x, int z, const int *pa, int64_t pW,
+        int b11)
+{
+    int a11 = pa[0];
+    int bn = -1;
+    uint64_t cs;
+
+    if (mc >= MC_1_7)
+        bn = (b11 - 2) % 29;
+
+    if (bn == 1 && b11 >= 2 && !bpIs(bp, a11, BF_SHALLOW))
+    {
+        int m = bpMutated(bp, a11);
+        return m > 0 ? m : a11;
+    }
+
+    cs = getChunkSeed(ss, x, z);
+    if (bn != 0 && !mcFirstIsZero(cs, 3))
+        return a11;
+
+    int hillID = a11;
+
+    switch (a11)
+    {
+    case desert:
+        hillID = desert_hills;
+        break;
+    case forest:
+        hillID = wooded_hills;
+        break;
+    case birch_forest:
+        hillID = birch_forest_hills;
+        break;
+    case dark_forest:
+        hillID = plains;
+        break;
+    case taiga:
+        hillID = taiga_hills;
+        break;
+    case giant_tree_taiga:
+        hillID = giant_tree_taiga_hills;
+        break;
+    case snowy_taiga:
+        hillID = snowy_taiga_hills;
+        break;
+    case plains:
+        if (mc <= MC_1_6) {
+            hillID = forest;
+            break;
+        }
+        cs = mcStepSeed(cs, st);
+        hillID = mcFirstIsZero(cs, 3) ? wooded_hills : forest;
+        break;
+    case snowy_tundra:
+        hillID = snowy_mountains;
+        break;
+    case jungle:
+        hillID = jungle_hills;
+        break;
+    case bamboo_jungle:
+        hillID = bamboo_jungle_hills;
+        break;
+    case ocean:
+        if (mc >= MC_1_7)
+            hillID = deep_ocean;
+        break;
+    case mountains:
+        if (mc >= MC_1_7)
+            hillID = wooded_mountains;
+        break;
+    case savanna:
+        hillID = savanna_plateau;
+        break;
+    default:
+        if (bpSimilar(bp, a11, wooded_badlands_plateau))
+            hillID = badlands;
+        else if (bpIs(bp, a11, BF_DEEP))
+        {
+            cs = mcStepSeed(cs, st);
+            if (mcFirstIsZero(cs, 3))
             {
-                if (v11 == desert)
-                {
-                    if (!isAny4(snowy_tundra, v10, v21, v01, v12))
-                    {
-                        out[i + j*w] = v11;
-                    }
-                    else
-                    {
-                        out[i + j*w] = wooded_mountains;
-                    }
-                }
-                else if (v11 == swamp)
-                {
-                    if (!isAny4(desert, v10, v21, v01, v12) &&
-                        !isAny4(snowy_taiga, v10, v21, v01, v12) &&
-                        !isAny4(snowy_tundra, v10, v21, v01, v12))
-                    {
-                        if (!isAny4(jungle, v10, v21, v01, v12) &&
-                            !isAny4(bamboo_jungle, v10, v21, v01, v12))
-                            out[i + j*w] = v11;
-                        else
-                            out[i + j*w] = jungle_edge;
-                    }
-                    else
-                    {
-                        out[i + j*w] = plains;
-                    }
-                }
-                else
-                {
-                    out[i + j*w] = v11;
-                }
+                cs = mcStepSeed(cs, st);
+                hillID = mcFirstIsZero(cs, 2) ? plains : forest;
             }
         }
+        break;
     }
 
-    return 0;
+    if (bn == 0 && hillID != a11)
+    {
+        hillID = bpMutated(bp, hillID);
+        if (hillID < 0)
+            hillID = a11;
+    }
+
+    if (hillID == a11)
+        return a11;
+
+    int equals = 0;
+
+    if (bpSimilar(bp, pa[-pW], a11)) equals++;
+    if (bpSimilar(bp, pa[1], a11)) equals++;
+    if (bpSimilar(bp, pa[-1], a11)) equals++;
+    if (bpSimilar(bp, pa[pW], a11)) equals++;
+
+    return equals >= 3 + (mc <= MC_1_6) ? hillID : a11;
+}
+
+#if LAYER_SIMD_X86
+
+/* Two thirds of the cells keep their biome on the 1-in-3 chunk seed roll,
+ * unless the river branch asks for a mutation. These rolls are drawn for 8
+ * cells at once and only the remaining cells go through the scalar code.
+ */
+ATTR(target(AVX512_LAYER))
+static int64_t mapHillsRowAVX512(int *out, int mc, const BiomeProps *bp,
+        uint64_t st, uint64_t ss, int x, int z, const int *pa, const int *pb,
+        int64_t pW, int64_t w)
+{
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m512d m29 = _mm512_set1_pd(29);
+    int64_t i;
+    int k;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        __m256i a11 = _mm256_loadu_si256((const __m256i*)(pa + i));
+        __m256i b11 = _mm256_loadu_si256((const __m256i*)(pb + i));
+        __m512i cs = chunkSeedRowAVX512(ss, x + (int) i, z);
+        __mmask8 keep = ~firstIsZeroAVX512(cs, 3);
+
+        if (mc >= MC_1_7)
+        {   // bn = (b11 - 2) % 29, truncated, for bn == 0 and bn == 1
+            __m512d v = _mm512_cvtepi32_pd(_mm256_sub_epi32(b11, two));
+            __m512d q = _mm512_roundscale_pd(_mm512_div_pd(v, m29),
+                _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+            __m512d bn = _mm512_fnmadd_pd(q, m29, v);
+            __mmask8 bn0 = _mm512_cmp_pd_mask(bn, _mm512_setzero_pd(), _CMP_EQ_OQ);
+            __mmask8 bn1 = _mm512_cmp_pd_mask(bn, _mm512_set1_pd(1), _CMP_EQ_OQ);
+            bn1 &= _mm256_cmpge_epi32_mask(b11, two);
+            bn1 &= ~isAnyOfAVX512(a11, SHALLOW_OCEAN_BITS);
+            keep &= ~(bn0 | bn1);
+        }
+
+        int t[8];
+        _mm256_storeu_si256((__m256i*) t, a11);
+        for (k = 0; k < 8; k++)
+        {
+            if (keep >> k & 1)
+                continue;
+            t[k] = mapHillsCell(mc, bp, st, ss, x + (int)(i + k), z,
+                pa + i + k, pW, pb[i+k]);
+        }
+        memcpy(out + i, t, sizeof(t));
+    }
+    return i;
 }
 
+#endif // LAYER_SIMD_X86
 
 int mapHills(const Layer * l, int * out, int x, int z, int w, int h)
 {
@@ -1108,138 +1577,30 @@ int mapHills(const Layer * l, int * out, int x, int z, int w, int h)
         return err;
 
     int mc = l->mc;
+    const BiomeProps *bp = getBiomeProps(mc);
     uint64_t st = l->startSalt;
     uint64_t ss = l->startSeed;
-    uint64_t cs;
+
+#if LAYER_SIMD_X86
+    int avx512 = __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vl");
+#endif
 
     for (j = 0; j < h; j++)
     {
-        for (i = 0; i < w; i++)
+        const int *pa = out + 1 + (j+1)*pW; // biome branch
+        const int *pb = riv + 1 + (j+1)*pW; // river branch
+
+        i = 0;
+#if LAYER_SIMD_X86
+        if (avx512)
+            i = mapHillsRowAVX512(out + j*w, mc, bp, st, ss, x, j + z,
+                pa, pb, pW, w);
+#endif
+        for (; i < w; i++)
         {
-            int a11 = out[i+1 + (j+1)*pW]; // biome branch
-            int b11 = riv[i+1 + (j+1)*pW]; // river branch
-            int64_t idx = i + j*w;
-            int bn = -1;
-
-            if (mc >= MC_1_7)
-                bn = (b11 - 2) % 29;
-
-            if (bn == 1 && b11 >= 2 && !isShallowOcean(a11))
-            {
-                int m = getMutated(mc, a11);
-                if (m > 0)
-                    out[idx] = m;
-                else
-                    out[idx] = a11;
-            }
-            else
-            {
-                cs = getChunkSeed(ss, i + x, j + z);
-                if (bn == 0 || mcFirstIsZero(cs, 3))
-                {
-                    int hillID = a11;
-
-                    switch (a11)
-                    {
-                    case desert:
-                        hillID = desert_hills;
-                        break;
-                    case forest:
-                        hillID = wooded_hills;
-                        break;
-                    case birch_forest:
-                        hillID = birch_forest_hills;
-                        break;
-                    case dark_forest:
-                        hillID = plains;
-                        break;
-                    case taiga:
-                        hillID = taiga_hills;
-                        break;
-                    case giant_tree_taiga:
-                        hillID = giant_tree_taiga_hills;
-                        break;
-                    case snowy_taiga:
-                        hillID = snowy_taiga_hills;
-                        break;
-                    case plains:
-                        if (mc <= MC_1_6) {
-                            hillID = forest;
-                            break;
-                        }
-                        cs = mcStepSeed(cs, st);
-                        hillID = mcFirstIsZero(cs, 3) ? wooded_hills : forest;
-                        break;
-                    case snowy_tundra:
-                        hillID = snowy_mountains;
-                        break;
-                    case jungle:
-                        hillID = jungle_hills;
-                        break;
-                    case bamboo_jungle:
-                        hillID = bamboo_jungle_hills;
-                        break;
-                    case ocean:
-                        if (mc >= MC_1_7)
-                            hillID = deep_ocean;
-                        break;
-                    case mountains:
-                        if (mc >= MC_1_7)
-                            hillID = wooded_mountains;
-                        break;
-                    case savanna:
-                        hillID = savanna_plateau;
-                        break;
-                    default:
-                        if (areSimilar(mc, a11, wooded_badlands_plateau))
-                            hillID = badlands;
-                        else if (isDeepOcean(a11))
-                        {
-                            cs = mcStepSeed(cs, st);
-                            if (mcFirstIsZero(cs, 3))
-                            {
-                                cs = mcStepSeed(cs, st);
-                                hillID = mcFirstIsZero(cs, 2) ? plains : forest;
-                            }
-                        }
-                        break;
-                    }
-
-                    if (bn == 0 && hillID != a11)
-                    {
-                        hillID = getMutated(mc, hillID);
-                        if (hillID < 0)
-                            hillID = a11;
-                    }
-
-                    if (hillID != a11)
-                    {
-                        int a10 = out[i+1 + (j+0)*pW];
-                        int a21 = out[i+2 + (j+1)*pW];
-                        int a01 = out[i+0 + (j+1)*pW];
-                        int a12 = out[i+1 + (j+2)*pW];
-                        int equals = 0;
-
-                        if (areSimilar(mc, a10, a11)) equals++;
-                        if (areSimilar(mc, a21, a11)) equals++;
-                        if (areSimilar(mc, a01, a11)) equals++;
-                        if (areSimilar(mc, a12, a11)) equals++;
-
-                        if (equals >= 3 + (mc <= MC_1_6))
-                            out[idx] = hillID;
-                        else
-                            out[idx] = a11;
-                    }
-                    else
-                    {
-                        out[idx] = a11;
-                    }
-                }
-                else
-                {
-                    out[idx] = a11;
-                }
-            }
+            out[i + j*w] = mapHillsCell(mc, bp, st, ss, i + x, j + z,
+                pa + i, pW, pb[i]);
         }
     }
 
@@ -1252,6 +1613,55 @@ static inline int reduceID(int id)
     return id >= 2 ? 2 + (id & 1) : id;
 }
 
+#if LAYER_SIMD_X86
+
+ATTR(target("avx2"))
+static inline __m256i reduceIDAVX2(__m256i id)
+{
+    __m256i r = _mm256_or_si256(_mm256_and_si256(id, _mm256_set1_epi32(1)),
+        _mm256_set1_epi32(2));
+    return _mm256_blendv_epi8(id, r, _mm256_cmpgt_epi32(id, _mm256_set1_epi32(1)));
+}
+
+ATTR(target("avx2"))
+static int64_t mapRiverRowAVX2(int *out, int mc,
+        const int *vz0, const int *vz1, const int *vz2, int64_t w)
+{
+    int64_t i;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        __m256i v11 = _mm256_loadu_si256((const __m256i*)(vz1 + i + 1));
+        __m256i v10 = _mm256_loadu_si256((const __m256i*)(vz0 + i + 1));
+        __m256i v21 = _mm256_loadu_si256((const __m256i*)(vz1 + i + 2));
+        __m256i v01 = _mm256_loadu_si256((const __m256i*)(vz1 + i + 0));
+        __m256i v12 = _mm256_loadu_si256((const __m256i*)(vz2 + i + 1));
+        __m256i keep;
+
+        if (mc >= MC_1_7)
+        {
+            v11 = reduceIDAVX2(v11);
+            v10 = reduceIDAVX2(v10);
+            v21 = reduceIDAVX2(v21);
+            v01 = reduceIDAVX2(v01);
+            v12 = reduceIDAVX2(v12);
+        }
+        keep = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpeq_epi32(v11, v10), _mm256_cmpeq_epi32(v11, v21)),
+            _mm256_and_si256(_mm256_cmpeq_epi32(v11, v01), _mm256_cmpeq_epi32(v11, v12)));
+        if (mc <= MC_1_6)
+            keep = _mm256_andnot_si256(
+                _mm256_cmpeq_epi32(v11, _mm256_setzero_si256()), keep);
+
+        // kept cells are -1, i.e. all bits set
+        _mm256_storeu_si256((__m256i*)(out + i),
+            _mm256_or_si256(keep, _mm256_set1_epi32(river)));
+    }
+    return i;
+}
+
+#endif // LAYER_SIMD_X86
+
 int mapRiver(const Layer * l, int * out, int x, int z, int w, int h)
 {
     int pX = x - 1;
@@ -1266,13 +1676,22 @@ int mapRiver(const Layer * l, int * out, int x, int z, int w, int h)
 
     int mc = l->mc;
 
+#if LAYER_SIMD_X86
+    int avx2 = __builtin_cpu_supports("avx2");
+#endif
+
     for (j = 0; j < h; j++)
     {
         int *vz0 = out + (j+0)*pW;
         int *vz1 = out + (j+1)*pW;
         int *vz2 = out + (j+2)*pW;
 
-        for (i = 0; i < w; i++)
+        i = 0;
+#if LAYER_SIMD_X86
+        if (avx2)
+            i = mapRiverRowAVX2(out + j*w, mc, vz0, vz1, vz2, w);
+#endif
+        for (; i < w; i++)
         {
             int v01 = vz1[i+0];
             int v11 = vz1[i+1];
@@ -1309,6 +1728,64 @@ int mapRiver(const Layer * l, int * out, int x, int z, int w, int h)
 }
 
 
+#if LAYER_SIMD_X86
+
+/* Smooth resolves most cells by comparisons alone. Only the cells between two
+ * different pairs of equal opposite neighbours draw a chunk seed to choose
+ * one of them, which is done per cell.
+ */
+ATTR(target("avx2"))
+static int64_t mapSmoothRowAVX2(int *out, uint64_t ss, int x, int z,
+        const int *vz0, const int *vz1, const int *vz2, int64_t w)
+{
+    int64_t i;
+    int k;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        __m256i v11 = _mm256_loadu_si256((const __m256i*)(vz1 + i + 1));
+        __m256i v10 = _mm256_loadu_si256((const __m256i*)(vz0 + i + 1));
+        __m256i v21 = _mm256_loadu_si256((const __m256i*)(vz1 + i + 2));
+        __m256i v01 = _mm256_loadu_si256((const __m256i*)(vz1 + i + 0));
+        __m256i v12 = _mm256_loadu_si256((const __m256i*)(vz2 + i + 1));
+
+        __m256i eqx = _mm256_cmpeq_epi32(v01, v21);
+        __m256i eqz = _mm256_cmpeq_epi32(v10, v12);
+        __m256i keep = _mm256_and_si256(
+            _mm256_cmpeq_epi32(v11, v01), _mm256_cmpeq_epi32(v11, v10));
+
+        __m256i r = _mm256_blendv_epi8(v11, v01, eqx);
+        r = _mm256_blendv_epi8(r, v10, eqz);
+        r = _mm256_blendv_epi8(r, v11, keep);
+
+        // the chunk seed only matters when the two choices differ
+        __m256i rng = _mm256_andnot_si256(
+            _mm256_or_si256(keep, _mm256_cmpeq_epi32(v01, v10)),
+            _mm256_and_si256(eqx, eqz));
+        int m = _mm256_movemask_ps(_mm256_castsi256_ps(rng));
+
+        if (m == 0)
+        {
+            _mm256_storeu_si256((__m256i*)(out + i), r);
+            continue;
+        }
+
+        int t[8];
+        _mm256_storeu_si256((__m256i*) t, r);
+        for (k = 0; k < 8; k++)
+        {
+            if (!(m >> k & 1))
+                continue;
+            uint64_t cs = getChunkSeed(ss, x + (int)(i + k), z);
+            t[k] = (cs & (1ULL << 24)) ? vz0[i+k+1] : vz1[i+k];
+        }
+        memcpy(out + i, t, sizeof(t));
+    }
+    return i;
+}
+
+#endif // LAYER_SIMD_X86
+
 int mapSmooth(const Layer * l, int * out, int x, int z, int w, int h)
 {
     int pX = x - 1;
@@ -1324,13 +1801,22 @@ int mapSmooth(const Layer * l, int * out, int x, int z, int w, int h)
     uint64_t ss = l->startSeed;
     uint64_t cs;
 
+#if LAYER_SIMD_X86
+    int avx2 = __builtin_cpu_supports("avx2");
+#endif
+
     for (j = 0; j < h; j++)
     {
         int *vz0 = out + (j+0)*pW;
         int *vz1 = out + (j+1)*pW;
         int *vz2 = out + (j+2)*pW;
 
-        for (i = 0; i < w; i++)
+        i = 0;
+#if LAYER_SIMD_X86
+        if (avx2)
+            i = mapSmoothRowAVX2(out + j*w, ss, x, j + z, vz0, vz1, vz2, w);
+#endif
+        for (; i < w; i++)
         {
             int v11 = vz1[i+1];
             int v01 = vz1[i+0];
@@ -1394,11 +1880,17 @@ int mapSunflower(const Layer * l, int * out, int x, int z, int w, int h)
 }
 
 
-inline static int replaceOcean(int *out, int idx, int v10, int v21, int v01, int v12, int id, int replaceID)
+inline static int isAny4Oceanic(const BiomeProps *bp, int a, int b, int c, int d)
+{
+    return bpIs(bp, a, BF_OCEANIC) || bpIs(bp, b, BF_OCEANIC) ||
+        bpIs(bp, c, BF_OCEANIC) || bpIs(bp, d, BF_OCEANIC);
+}
+
+inline static int replaceOcean(int *out, int idx, const BiomeProps *bp, int v10, int v21, int v01, int v12, int id, int replaceID)
 {
-    if (isOceanic(id)) return 0;
+    if (bpIs(bp, id, BF_OCEANIC)) return 0;
 
-    if (isOceanic(v10) || isOceanic(v21) || isOceanic(v01) || isOceanic(v12))
+    if (isAny4Oceanic(bp, v10, v21, v01, v12))
         out[idx] = replaceID;
     else
         out[idx] = id;
@@ -1406,126 +1898,185 @@ inline static int replaceOcean(int *out, int idx, int v10, int v21, int v01, int
     return 1;
 }
 
-inline static int isAll4JFTO(int mc, int a, int b, int c, int d)
+inline static int isJFTO(const BiomeProps *bp, int id)
 {
-    return
-        (getCategory(mc, a) == jungle || a == forest || a == taiga || isOceanic(a)) &&
-        (getCategory(mc, b) == jungle || b == forest || b == taiga || isOceanic(b)) &&
-        (getCategory(mc, c) == jungle || c == forest || c == taiga || isOceanic(c)) &&
-        (getCategory(mc, d) == jungle || d == forest || d == taiga || isOceanic(d));
+    return bpCategory(bp, id) == jungle || id == forest || id == taiga ||
+        bpIs(bp, id, BF_OCEANIC);
 }
 
-inline static int isAny4Oceanic(int a, int b, int c, int d)
+inline static int isAll4JFTO(const BiomeProps *bp, int a, int b, int c, int d)
 {
-    return isOceanic(a) || isOceanic(b) || isOceanic(c) || isOceanic(d);
+    return isJFTO(bp, a) && isJFTO(bp, b) && isJFTO(bp, c) && isJFTO(bp, d);
 }
 
-int mapShore(const Layer * l, int * out, int x, int z, int w, int h)
+/// Shore of a cell, which is not written for the oceanic snowy biomes.
+static inline void mapShoreCell(int *out, int mc, const BiomeProps *bp,
+        int v11, int v10, int v21, int v01, int v12)
 {
-    int pX = x - 1;
-    int pZ = z - 1;
-    int64_t pW = w + 2;
-    int64_t pH = h + 2;
-    int64_t i, j;
-
-    int err = l->p->getMap(l->p, out, pX, pZ, pW, pH);
-    if unlikely(err != 0)
-        return err;
-
-    int mc = l->mc;
-
-    for (j = 0; j < h; j++)
+    if (v11 == mushroom_fields)
     {
-        int *vz0 = out + (j+0)*pW;
-        int *vz1 = out + (j+1)*pW;
-        int *vz2 = out + (j+2)*pW;
+        if (isAny4(ocean, v10, v21, v01, v12))
+            *out = mushroom_field_shore;
+        else
+            *out = v11;
+        return;
+    }
+    if (mc <= MC_1_0)
+    {
+        *out = v11;
+        return;
+    }
 
-        for (i = 0; i < w; i++)
+    if (mc <= MC_1_6)
+    {
+        if (v11 == mountains)
         {
-            int v11 = vz1[i+1];
-            int v10 = vz0[i+1];
-            int v21 = vz1[i+2];
-            int v01 = vz1[i+0];
-            int v12 = vz2[i+1];
-
-            if (v11 == mushroom_fields)
-            {
-                if (isAny4(ocean, v10, v21, v01, v12))
-                    out[i + j*w] = mushroom_field_shore;
-                else
-                    out[i + j*w] = v11;
-                continue;
-            }
-            if (mc <= MC_1_0)
-            {
-                out[i + j*w] = v11;
-                continue;
-            }
+            if (v10 != mountains || v21 != mountains || v01 != mountains || v12 != mountains)
+                v11 = mountain_edge;
+        }
+        else if (v11 != ocean && v11 != river && v11 != swamp)
+        {
+            if (isAny4(ocean, v10, v21, v01, v12))
+                v11 = beach;
+        }
+        *out = v11;
+    }
+    else if (bpCategory(bp, v11) == jungle)
+    {
+        if (isAll4JFTO(bp, v10, v21, v01, v12))
+        {
+            if (isAny4Oceanic(bp, v10, v21, v01, v12))
+                *out = beach;
+            else
+                *out = v11;
+        }
+        else
+        {
+            *out = jungle_edge;
+        }
+    }
+    else if (v11 == mountains || v11 == wooded_mountains /* || v11 == mountain_edge*/)
+    {
+        replaceOcean(out, 0, bp, v10, v21, v01, v12, v11, stone_shore);
+    }
+    else if (bpIs(bp, v11, BF_SNOWY))
+    {
+        replaceOcean(out, 0, bp, v10, v21, v01, v12, v11, snowy_beach);
+    }
+    else if (v11 == badlands || v11 == wooded_badlands_plateau)
+    {
+        if (!isAny4Oceanic(bp, v10, v21, v01, v12))
+        {
+            if (bpIs(bp, v10, BF_MESA) && bpIs(bp, v21, BF_MESA) &&
+                bpIs(bp, v01, BF_MESA) && bpIs(bp, v12, BF_MESA))
+                *out = v11;
+            else
+                *out = desert;
+        }
+        else
+        {
+            *out = v11;
+        }
+    }
+    else
+    {
+        if (v11 != ocean && v11 != deep_ocean && v11 != river && v11 != swamp)
+        {
+            if (isAny4Oceanic(bp, v10, v21, v01, v12))
+                *out = beach;
+            else
+                *out = v11;
+        }
+        else
+        {
+            *out = v11;
+        }
+    }
+}
 
-            if (mc <= MC_1_6)
-            {
-                if (v11 == mountains)
-                {
-                    if (v10 != mountains || v21 != mountains || v01 != mountains || v12 != mountains)
-                        v11 = mountain_edge;
-                }
-                else if (v11 != ocean && v11 != river && v11 != swamp)
-                {
-                    if (isAny4(ocean, v10, v21, v01, v12))
-                        v11 = beach;
-                }
-                out[i + j*w] = v11;
-            }
-            else if (getCategory(mc, v11) == jungle)
-            {
-                if (isAll4JFTO(mc, v10, v21, v01, v12))
-                {
-                    if (isAny4Oceanic(v10, v21, v01, v12))
-                        out[i + j*w] = beach;
-                    else
-                        out[i + j*w] = v11;
-                }
-                else
-                {
-                    out[i + j*w] = jungle_edge;
-                }
-            }
-            else if (v11 == mountains || v11 == wooded_mountains /* || v11 == mountain_edge*/)
-            {
-                replaceOcean(out, i + j*w, v10, v21, v01, v12, v11, stone_shore);
-            }
-            else if (isSnowy(v11))
-            {
-                replaceOcean(out, i + j*w, v10, v21, v01, v12, v11, snowy_beach);
-            }
-            else if (v11 == badlands || v11 == wooded_badlands_plateau)
-            {
-                if (!isAny4Oceanic(v10, v21, v01, v12))
-                {
-                    if (isMesa(v10) && isMesa(v21) && isMesa(v01) && isMesa(v12))
-                        out[i + j*w] = v11;
-                    else
-                        out[i + j*w] = desert;
-                }
-                else
-                {
-                    out[i + j*w] = v11;
-                }
-            }
+#if LAYER_SIMD_X86
+
+/* A cell whose four neighbours equal its own biome stays unchanged, except
+ * for the oceans that mapShoreCell() leaves unwritten or turns into beaches.
+ */
+#define SHORE_KEEP_OCEAN_BITS ((1ULL << ocean) | (1ULL << deep_ocean))
+
+ATTR(target("avx2"))
+static int64_t mapShoreRowAVX2(int *out, int mc, const BiomeProps *bp,
+        const int *vz0, const int *vz1, const int *vz2, int64_t w)
+{
+    const uint64_t other = (SHALLOW_OCEAN_BITS | DEEP_OCEAN_BITS) &
+        ~SHORE_KEEP_OCEAN_BITS;
+    int64_t i;
+    int k;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        __m256i v11;
+        int t[8];
+        int m = loadCrossAVX2(vz0 + i, vz1 + i, vz2 + i, &v11);
+        m &= ~_mm256_movemask_ps(_mm256_castsi256_ps(isAnyOfAVX2(v11, other)));
+        if (m == 0xff)
+        {
+            _mm256_storeu_si256((__m256i*)(out + i), v11);
+            continue;
+        }
+        // unwritten cells keep the value that is already in the buffer
+        memcpy(t, out + i, sizeof(t));
+        for (k = 0; k < 8; k++)
+        {
+            if (m >> k & 1)
+                t[k] = vz1[i+k+1];
             else
-            {
-                if (v11 != ocean && v11 != deep_ocean && v11 != river && v11 != swamp)
-                {
-                    if (isAny4Oceanic(v10, v21, v01, v12))
-                        out[i + j*w] = beach;
-                    else
-                        out[i + j*w] = v11;
-                }
-                else
-                {
-                    out[i + j*w] = v11;
-                }
-            }
+                mapShoreCell(t + k, mc, bp, vz1[i+k+1],
+                    vz0[i+k+1], vz1[i+k+2], vz1[i+k+0], vz2[i+k+1]);
+        }
+        memcpy(out + i, t, sizeof(t));
+    }
+    return i;
+}
+
+#endif // LAYER_SIMD_X86
+
+int mapShore(const Layer * l, int * out, int x, int z, int w, int h)
+{
+    int pX = x - 1;
+    int pZ = z - 1;
+    int64_t pW = w + 2;
+    int64_t pH = h + 2;
+    int64_t i, j;
+
+    int err = l->p->getMap(l->p, out, pX, pZ, pW, pH);
+    if unlikely(err != 0)
+        return err;
+
+    int mc = l->mc;
+    const BiomeProps *bp = getBiomeProps(mc);
+
+#if LAYER_SIMD_X86
+    int avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    for (j = 0; j < h; j++)
+    {
+        int *vz0 = out + (j+0)*pW;
+        int *vz1 = out + (j+1)*pW;
+        int *vz2 = out + (j+2)*pW;
+
+        i = 0;
+#if LAYER_SIMD_X86
+        if (avx2)
+            i = mapShoreRowAVX2(out + j*w, mc, bp, vz0, vz1, vz2, w);
+#endif
+        for (; i < w; i++)
+        {
+            int v11 = vz1[i+1];
+            int v10 = vz0[i+1];
+            int v21 = vz1[i+2];
+            int v01 = vz1[i+0];
+            int v12 = vz2[i+1];
+
+            mapShoreCell(out + i + j*w, mc, bp, v11, v10, v21, v01, v12);
         }
     }
 
@@ -1577,6 +2128,7 @@ int mapRiverMix(const Layer * l, int * out, int x, int z, int w, int h)
     int64_t len = w*(int64_t)h;
     int64_t idx;
     int mc = l->mc;
+    const BiomeProps *bp = getBiomeProps(mc);
     int *buf = out + len;
 
     err = l->p2->getMap(l->p2, buf, x, z, w, h); // rivers
@@ -1588,7 +2140,7 @@ int mapRiverMix(const Layer * l, int * out, int x, int z, int w, int h)
     {
         int v = out[idx];
 
-        if (buf[idx] == river && v != ocean && (mc <= MC_1_6 || !isOceanic(v)))
+        if (buf[idx] == river && v != ocean && (mc <= MC_1_6 || !bpIs(bp, v, BF_OCEANIC)))
         {
             if (v == snowy_tundra)
                 v = frozen_river;
@@ -1678,6 +2230,8 @@ int mapOceanMix(const Layer * l, int * out, int x, int z, int w, int h)
     if unlikely(err != 0)
         return err;
 
+    const BiomeProps *bp = getBiomeProps(l->mc);
+
     for (j = 0; j < h; j++)
     {
         for (i = 0; i < w; i++)
@@ -1687,7 +2241,7 @@ int mapOceanMix(const Layer * l, int * out, int x, int z, int w, int h)
             int replaceID = 0;
             int ii, jj;
 
-            if (!isOceanic(landID))
+            if (!bpIs(bp, landID, BF_OCEANIC))
             {
                 out[i + j*w] = landID;
                 continue;
@@ -1702,7 +2256,7 @@ int mapOceanMix(const Layer * l, int * out, int x, int z, int w, int h)
                     for (jj = -8; jj <= 8; jj += 4)
                     {
                         int id = land[(i+ii-lx0) + (j+jj-lz0)*lw];
-                        if (!isOceanic(id))
+                        if (!bpIs(bp, id, BF_OCEANIC))
                         {
                             out[i + j*w] = replaceID;
                             goto loop_x;
@@ -1758,162 +2312,283 @@ static inline void getVoronoiCell(uint64_t sha, int a, int b, int c,
     *z = (((s >> 24) & 1023) - 512) * 36;
 }
 
+/* The voronoi zoom of 1.15+ assigns each block to the nearest of the eight
+ * 1:4 cells around it, where each cell is jittered by a hash of its
+ * position. The jitter is computed once per cell of the source range and the
+ * up to four blocks of a cell row are resolved together.
+ *
+ * The candidates are compared in the order (bx << 2 | by << 1 | bz) as in
+ * voronoiAccess3D(), except for the plane mapping, which has always taken a
+ * different order. The order decides ties, so both are kept.
+ */
+static const uint8_t g_voronoi_order_3d[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+static const uint8_t g_voronoi_order_2d[8] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+
+/// Jitter of the cells [px, px+pw) x [py, py+pn) x [pz, pz+ph) as x,y,z
+/// triples, indexed by ((y-py)*ph + (z-pz))*pw + (x-px).
+static int *getVoronoiJitter(uint64_t sha,
+        int px, int py, int pz, int pw, int ph, int pn)
+{
+    int *jit = (int*) malloc(sizeof(int) * 3 * pw * (int64_t)ph * pn);
+    int64_t idx = 0;
+    int i, j, k;
+
+    for (k = 0; k < pn; k++)
+    {
+        for (j = 0; j < ph; j++)
+        {
+            for (i = 0; i < pw; i++, idx += 3)
+            {
+                getVoronoiCell(sha, px+i, py+k, pz+j,
+                    jit+idx+0, jit+idx+1, jit+idx+2);
+            }
+        }
+    }
+    return jit;
+}
+
+/// Nearest candidates for the blocks at dx = (lane+0..n-1) * 10240 within a
+/// cell, given the x-offsets and the remaining squared yz-distance of the
+/// candidates.
+static void voronoiLanes(int *out, int n, int lane,
+        const int *rx, const int64_t *ryz, const int *v)
+{
+    int l, c;
+
+    for (l = 0; l < n; l++)
+    {
+        int dx = (lane + l) * 10240;
+        int64_t d, dmin = INT64_MAX;
+        int best = v[0];
+        for (c = 0; c < 8; c++)
+        {
+            int64_t r = rx[c] + dx;
+            d = r*r + ryz[c];
+            if (d < dmin)
+            {
+                dmin = d;
+                best = v[c];
+            }
+        }
+        out[l] = best;
+    }
+}
+
+#if LAYER_SIMD_X86
+ATTR(target("avx2"))
+static void voronoiLanesAVX2(int *out, int n, int lane,
+        const int *rx, const int64_t *ryz, const int *v)
+{
+    __m256i dx = _mm256_setr_epi64x(
+        (lane+0) * 10240, (lane+1) * 10240, (lane+2) * 10240, (lane+3) * 10240);
+    __m256i dmin = _mm256_set1_epi64x(INT64_MAX);
+    __m256i best = _mm256_setzero_si256();
+    int64_t t[4];
+    int c, l;
+
+    for (c = 0; c < 8; c++)
+    {
+        __m256i r = _mm256_add_epi64(_mm256_set1_epi64x(rx[c]), dx);
+        __m256i d = _mm256_add_epi64(_mm256_mul_epi32(r, r),
+            _mm256_set1_epi64x(ryz[c]));
+        __m256i m = _mm256_cmpgt_epi64(dmin, d);
+        dmin = _mm256_blendv_epi8(dmin, d, m);
+        best = _mm256_blendv_epi8(best, _mm256_set1_epi64x(v[c]), m);
+    }
+    _mm256_storeu_si256((__m256i*) t, best);
+    for (l = 0; l < n; l++)
+        out[l] = (int) t[l];
+}
+#endif
+
+/// Resolves n blocks of a cell row, starting at the lane, from the jitter
+/// triples jt and the biomes v of the eight candidate cells, where dy and dz
+/// are the offsets of the blocks in the cell.
+static void voronoiRow(int *out, int n, int lane, int dy, int dz,
+        const int *const *jt, const int *v, const uint8_t *order)
+{
+    int rx[8], vo[8];
+    int64_t ryz[8];
+    int c;
+
+    for (c = 0; c < 8; c++)
+    {
+        int bx = (order[c] >> 2) & 1;
+        int by = (order[c] >> 1) & 1;
+        int bz = (order[c] >> 0) & 1;
+        const int *t = jt[order[c]];
+        int64_t ry = t[1] + dy - 40*1024*by;
+        int64_t rz = t[2] + dz - 40*1024*bz;
+        rx[c] = t[0] - 40*1024*bx;
+        ryz[c] = ry*ry + rz*rz;
+        vo[c] = v[order[c]];
+    }
+#if LAYER_SIMD_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        voronoiLanesAVX2(out, n, lane, rx, ryz, vo);
+        return;
+    }
+#endif
+    voronoiLanes(out, n, lane, rx, ryz, vo);
+}
+
+/// Maps one layer of blocks, at the offset dy in the cells, where jit0/src0
+/// and jit1/src1 are the lower and upper levels of cells. The block
+/// coordinates (x, z) are already shifted by -2.
+static void voronoiLayer(int *out, int x, int z, int w, int h, int dy,
+        const int *jit0, const int *jit1, const int *src0, const int *src1,
+        int px, int pz, int pw)
+{
+    const int *jt[8];
+    int v[8];
+    int i, j, c, n;
+
+    for (j = 0; j < h; j++)
+    {
+        int zz = z + j;
+        int64_t row = ((zz >> 2) - pz) * (int64_t) pw;
+        int dz = (zz & 3) * 10240;
+
+        for (i = 0; i < w; i += n)
+        {
+            int xx = x + i;
+            int64_t cell = row + (xx >> 2) - px;
+            int lane = xx & 3;
+            int uniform = 1;
+
+            n = 4 - lane;
+            if (n > w - i)
+                n = w - i;
+
+            for (c = 0; c < 8; c++)
+            {
+                int64_t idx = cell + (c & 1) * (int64_t) pw + (c >> 2);
+                jt[c] = ((c & 2) ? jit1 : jit0) + 3 * idx;
+                v[c] = ((c & 2) ? src1 : src0)[idx];
+                uniform &= v[c] == v[0];
+            }
+
+            int *p = out + j*(int64_t)w + i;
+            if (uniform)
+            {
+                for (c = 0; c < n; c++)
+                    p[c] = v[0];
+                continue;
+            }
+            voronoiRow(p, n, lane, dy, dz, jt, v, g_voronoi_order_3d);
+        }
+    }
+}
+
 void mapVoronoiPlane(uint64_t sha, int *out, int *src,
     int x, int z, int w, int h, int y, int px, int pz, int pw, int ph)
 {
     x -= 2;
     y -= 2;
     z -= 2;
-    int x000, x001, x010, x011, x100, x101, x110, x111;
-    int y000, y001, y010, y011, y100, y101, y110, y111;
-    int z000, z001, z010, z011, z100, z101, z110, z111;
-    int pi, pj, ii, jj, dx, dz, pjz, pix, i4, j4;
-    int v00, v01, v10, v11, v;
+    int cell[8][3];
+    const int *jt[8];
+    int v[8];
+    int pi, pj, ii, jj, pjz, pix, i4, j4, i0, i1, c;
     int prev_skip;
-    int64_t r;
-    uint64_t d, dmin;
-    int i, j;
+    int j;
+
+    for (c = 0; c < 8; c++)
+        jt[c] = cell[c];
 
     for (pj = 0; pj < ph-1; pj++)
     {
-        v00 = src[(pj+0)*(int64_t)pw];
-        v10 = src[(pj+1)*(int64_t)pw];
+        v[0] = v[2] = src[(pj+0)*(int64_t)pw];
+        v[1] = v[3] = src[(pj+1)*(int64_t)pw];
         pjz = pz + pj;
         j4 = pjz * 4 - z;
         prev_skip = 1;
 
         for (pi = 0; pi < pw-1; pi++)
         {
-            PREFETCH( out + (pjz * 4 + 0) * (int64_t)w + pi, 1, 1 );
-            PREFETCH( out + (pjz * 4 + 1) * (int64_t)w + pi, 1, 1 );
-            PREFETCH( out + (pjz * 4 + 2) * (int64_t)w + pi, 1, 1 );
-            PREFETCH( out + (pjz * 4 + 3) * (int64_t)w + pi, 1, 1 );
-
-            v01 = src[(pj+0)*(int64_t)pw + (pi+1)];
-            v11 = src[(pj+1)*(int64_t)pw + (pi+1)];
+            v[4] = v[6] = src[(pj+0)*(int64_t)pw + (pi+1)];
+            v[5] = v[7] = src[(pj+1)*(int64_t)pw + (pi+1)];
             pix = px + pi;
             i4 = pix * 4 - x;
+            i0 = i4 < 0 ? -i4 : 0;
+            i1 = i4 + 4 > w ? w - i4 : 4;
 
-            if (v00 == v01 && v00 == v10 && v00 == v11)
+            if (v[0] == v[4] && v[0] == v[1] && v[0] == v[5])
             {
                 for (jj = 0; jj < 4; jj++)
                 {
                     j = j4 + jj;
                     if (j < 0 || j >= h) continue;
-                    for (ii = 0; ii < 4; ii++)
-                    {
-                        i = i4 + ii;
-                        if (i < 0 || i >= w) continue;
-                        out[j*(int64_t)w + i] = v00;
-                    }
+                    for (ii = i0; ii < i1; ii++)
+                        out[j*(int64_t)w + i4 + ii] = v[0];
                 }
                 prev_skip = 1;
-                continue;
-            }
-            if (prev_skip)
-            {
-                getVoronoiCell(sha, pix, y-1, pjz+0, &x000, &y000, &z000);
-                getVoronoiCell(sha, pix, y+0, pjz+0, &x001, &y001, &z001);
-                getVoronoiCell(sha, pix, y-1, pjz+1, &x100, &y100, &z100);
-                getVoronoiCell(sha, pix, y+0, pjz+1, &x101, &y101, &z101);
-                prev_skip = 0;
             }
-            getVoronoiCell(sha, pix+1, y-1, pjz+0, &x010, &y010, &z010);
-            getVoronoiCell(sha, pix+1, y+0, pjz+0, &x011, &y011, &z011);
-            getVoronoiCell(sha, pix+1, y-1, pjz+1, &x110, &y110, &z110);
-            getVoronoiCell(sha, pix+1, y+0, pjz+1, &x111, &y111, &z111);
-
-
-            for (jj = 0; jj < 4; jj++)
+            else
             {
-                j = j4 + jj;
-                if (j < 0 || j >= h) continue;
-                for (ii = 0; ii < 4; ii++)
+                // candidates c = (bx << 2 | by << 1 | bz) at the cell levels
+                // y-1 and y, where the column bx = 1 is kept for the next cell
+                if (prev_skip)
                 {
-                    i = i4 + ii;
-                    if (i < 0 || i >= w) continue;
+                    for (c = 0; c < 4; c++)
+                        getVoronoiCell(sha, pix, y-1+(c>>1), pjz+(c&1),
+                            &cell[c][0], &cell[c][1], &cell[c][2]);
+                    prev_skip = 0;
+                }
+                for (c = 4; c < 8; c++)
+                    getVoronoiCell(sha, pix+1, y-1+((c>>1)&1), pjz+(c&1),
+                        &cell[c][0], &cell[c][1], &cell[c][2]);
 
-                    const int A = 40*1024;
-                    const int B = 20*1024;
-                    dx = ii * 10*1024;
-                    dz = jj * 10*1024;
-                    dmin = (uint64_t)-1;
-
-                    v = v00;
-                    d = 0;
-                    r = x000 - 0 + dx;  d += r*r;
-                    r = y000 + B;       d += r*r;
-                    r = z000 - 0 + dz;  d += r*r;
-                    if (d < dmin) { dmin = d; }
-                    d = 0;
-                    r = x001 - 0 + dx;  d += r*r;
-                    r = y001 - B;       d += r*r;
-                    r = z001 - 0 + dz;  d += r*r;
-                    if (d < dmin) { dmin = d; }
-
-                    d = 0;
-                    r = x010 - A + dx;  d += r*r;
-                    r = y010 + B;       d += r*r;
-                    r = z010 - 0 + dz;  d += r*r;
-                    if (d < dmin) { dmin = d; v = v01; }
-                    d = 0;
-                    r = x011 - A + dx;  d += r*r;
-                    r = y011 - B;       d += r*r;
-                    r = z011 - 0 + dz;  d += r*r;
-                    if (d < dmin) { dmin = d; v = v01; }
-
-                    d = 0;
-                    r = x100 - 0 + dx;  d += r*r;
-                    r = y100 + B;       d += r*r;
-                    r = z100 - A + dz;  d += r*r;
-                    if (d < dmin) { dmin = d; v = v10; }
-                    d = 0;
-                    r = x101 - 0 + dx;  d += r*r;
-                    r = y101 - B;       d += r*r;
-                    r = z101 - A + dz;  d += r*r;
-                    if (d < dmin) { dmin = d; v = v10; }
-
-                    d = 0;
-                    r = x110 - A + dx;  d += r*r;
-                    r = y110 + B;       d += r*r;
-                    r = z110 - A + dz;  d += r*r;
-                    if (d < dmin) { dmin = d; v = v11; }
-                    d = 0;
-                    r = x111 - A + dx;  d += r*r;
-                    r = y111 - B;       d += r*r;
-                    r = z111 - A + dz;  d += r*r;
-                    if (d < dmin) { dmin = d; v = v11; }
-
-                    out[j*(int64_t)w + i] = v;
+                for (jj = 0; jj < 4 && i0 < i1; jj++)
+                {
+                    j = j4 + jj;
+                    if (j < 0 || j >= h) continue;
+                    voronoiRow(out + j*(int64_t)w + i4 + i0, i1 - i0, i0,
+                        2*10240, jj*10240, jt, v, g_voronoi_order_2d);
                 }
+                memcpy(cell[0], cell[4], sizeof(cell[0]) * 4);
             }
-
-            x000 = x010;
-            y000 = y010;
-            z000 = z010;
-            x100 = x110;
-            y100 = y110;
-            z100 = z110;
-            x001 = x011;
-            y001 = y011;
-            z001 = z011;
-            x101 = x111;
-            y101 = y111;
-            z101 = z111;
-            v00 = v01;
-            v10 = v11;
+            v[0] = v[2] = v[4];
+            v[1] = v[3] = v[5];
         }
     }
 }
 
+void mapVoronoi3D(uint64_t sha, int *out, const int *src,
+    int x, int y, int z, int w, int h, int sy)
+{
+    int px = (x - 2) >> 2;
+    int py = (y - 2) >> 2;
+    int pz = (z - 2) >> 2;
+    int pw = ((x - 2 + w) >> 2) - px + 2;
+    int ph = ((z - 2 + h) >> 2) - pz + 2;
+    int pn = ((y - 2 + sy) >> 2) - py + 2;
+    int64_t plane = pw * (int64_t) ph;
+    int *jit = getVoronoiJitter(sha, px, py, pz, pw, ph, pn);
+    int k;
+
+    for (k = 0; k < sy; k++)
+    {
+        int yy = y - 2 + k;
+        int64_t lv = ((yy >> 2) - py) * plane;
+        voronoiLayer(out + k*(int64_t)w*h, x-2, z-2, w, h, (yy & 3) * 10240,
+            jit + 3*lv, jit + 3*(lv + plane), src + lv, src + lv + plane,
+            px, pz, pw);
+    }
+    free(jit);
+}
+
 int mapVoronoi(const Layer * l, int * out, int x, int z, int w, int h)
 {
     x -= 2;
     z -= 2;
-    int px = x >> 2;
-    int pz = z >> 2;
-    int pw = ((x + w) >> 2) - px + 2;
-    int ph = ((z + h) >> 2) - pz + 2;
+    // the plane mapping shifts the blocks by another -2, so the source range
+    // has to start at that cell for the first blocks to be covered
+    int px = (x - 2) >> 2;
+    int pz = (z - 2) >> 2;
+    int pw = ((x - 2 + w) >> 2) - px + 2;
+    int ph = ((z - 2 + h) >> 2) - pz + 2;
 
     if (l->p)
     {
@@ -2056,31 +2731,31 @@ int mapVoronoi114(const Layer * l, int * out, int x, int z, int w, int h)
 }
 
 
-uint64_t getVoronoiSHA(uint64_t seed)
+static const uint32_t g_sha256_k[64] = {
+    0x428a2f98,0x71374491, 0xb5c0fbcf,0xe9b5dba5,
+    0x3956c25b,0x59f111f1, 0x923f82a4,0xab1c5ed5,
+    0xd807aa98,0x12835b01, 0x243185be,0x550c7dc3,
+    0x72be5d74,0x80deb1fe, 0x9bdc06a7,0xc19bf174,
+    0xe49b69c1,0xefbe4786, 0x0fc19dc6,0x240ca1cc,
+    0x2de92c6f,0x4a7484aa, 0x5cb0a9dc,0x76f988da,
+    0x983e5152,0xa831c66d, 0xb00327c8,0xbf597fc7,
+    0xc6e00bf3,0xd5a79147, 0x06ca6351,0x14292967,
+    0x27b70a85,0x2e1b2138, 0x4d2c6dfc,0x53380d13,
+    0x650a7354,0x766a0abb, 0x81c2c92e,0x92722c85,
+    0xa2bfe8a1,0xa81a664b, 0xc24b8b70,0xc76c51a3,
+    0xd192e819,0xd6990624, 0xf40e3585,0x106aa070,
+    0x19a4c116,0x1e376c08, 0x2748774c,0x34b0bcb5,
+    0x391c0cb3,0x4ed8aa4a, 0x5b9cca4f,0x682e6ff3,
+    0x748f82ee,0x78a5636f, 0x84c87814,0x8cc70208,
+    0x90befffa,0xa4506ceb, 0xbef9a3f7,0xc67178f2,
+};
+static const uint32_t g_sha256_h[8] = {
+    0x6a09e667,0xbb67ae85, 0x3c6ef372,0xa54ff53a,
+    0x510e527f,0x9b05688c, 0x1f83d9ab,0x5be0cd19,
+};
+
+static uint64_t getVoronoiSHAScalar(uint64_t seed)
 {
-    static const uint32_t K[64] = {
-        0x428a2f98,0x71374491, 0xb5c0fbcf,0xe9b5dba5,
-        0x3956c25b,0x59f111f1, 0x923f82a4,0xab1c5ed5,
-        0xd807aa98,0x12835b01, 0x243185be,0x550c7dc3,
-        0x72be5d74,0x80deb1fe, 0x9bdc06a7,0xc19bf174,
-        0xe49b69c1,0xefbe4786, 0x0fc19dc6,0x240ca1cc,
-        0x2de92c6f,0x4a7484aa, 0x5cb0a9dc,0x76f988da,
-        0x983e5152,0xa831c66d, 0xb00327c8,0xbf597fc7,
-        0xc6e00bf3,0xd5a79147, 0x06ca6351,0x14292967,
-        0x27b70a85,0x2e1b2138, 0x4d2c6dfc,0x53380d13,
-        0x650a7354,0x766a0abb, 0x81c2c92e,0x92722c85,
-        0xa2bfe8a1,0xa81a664b, 0xc24b8b70,0xc76c51a3,
-        0xd192e819,0xd6990624, 0xf40e3585,0x106aa070,
-        0x19a4c116,0x1e376c08, 0x2748774c,0x34b0bcb5,
-        0x391c0cb3,0x4ed8aa4a, 0x5b9cca4f,0x682e6ff3,
-        0x748f82ee,0x78a5636f, 0x84c87814,0x8cc70208,
-        0x90befffa,0xa4506ceb, 0xbef9a3f7,0xc67178f2,
-    };
-    static const uint32_t B[8] = {
-        0x6a09e667,0xbb67ae85, 0x3c6ef372,0xa54ff53a,
-        0x510e527f,0x9b05688c, 0x1f83d9ab,0x5be0cd19,
-    };
-
     uint32_t m[64];
     uint32_t a0,a1,a2,a3,a4,a5,a6,a7;
     uint32_t i, x, y;
@@ -2100,18 +2775,18 @@ uint64_t getVoronoiSHA(uint64_t seed)
         m[i] += rotr32(x,17) ^ rotr32(x,19) ^ (x >> 10);
     }
 
-    a0 = B[0];
-    a1 = B[1];
-    a2 = B[2];
-    a3 = B[3];
-    a4 = B[4];
-    a5 = B[5];
-    a6 = B[6];
-    a7 = B[7];
+    a0 = g_sha256_h[0];
+    a1 = g_sha256_h[1];
+    a2 = g_sha256_h[2];
+    a3 = g_sha256_h[3];
+    a4 = g_sha256_h[4];
+    a5 = g_sha256_h[5];
+    a6 = g_sha256_h[6];
+    a7 = g_sha256_h[7];
 
     for (i = 0; i < 64; i++)
     {
-        x = a7 + K[i] + m[i];
+        x = a7 + g_sha256_k[i] + m[i];
         x += rotr32(a4,6) ^ rotr32(a4,11) ^ rotr32(a4,25);
         x += (a4 & a5) ^ (~a4 & a6);
 
@@ -2128,12 +2803,167 @@ uint64_t getVoronoiSHA(uint64_t seed)
         a0 = x + y;
     }
 
-    a0 += B[0];
-    a1 += B[1];
+    a0 += g_sha256_h[0];
+    a1 += g_sha256_h[1];
 
     return BSWAP32(a0) | ((uint64_t)BSWAP32(a1) << 32);
 }
 
+#if LAYER_SIMD_X86
+
+/* The hash is a single SHA-256 block, of which only the first two message
+ * words depend on the seed. The SHA extensions run it with the rounds in
+ * hardware, with the state in the ABEF/CDGH order of sha256rnds2.
+ */
+#define SHA_ROUNDS4(K, S0, S1, W) do { \
+        __m128i _m = _mm_add_epi32(W, _mm_loadu_si128((const __m128i*)(K))); \
+        S1 = _mm_sha256rnds2_epu32(S1, S0, _m); \
+        S0 = _mm_sha256rnds2_epu32(S0, S1, _mm_shuffle_epi32(_m, 0x0e)); \
+    } while (0)
+#define SHA_SCHEDULE(W0, W1, W2, W3) \
+    W0 = _mm_sha256msg2_epu32( \
+        _mm_add_epi32(_mm_sha256msg1_epu32(W0, W1), _mm_alignr_epi8(W3, W2, 4)), W3)
+
+ATTR(target("sha,sse4.1"))
+static uint64_t getVoronoiSHANI(uint64_t seed)
+{
+    const uint32_t *H = g_sha256_h;
+    __m128i s0 = _mm_set_epi32(H[0], H[1], H[4], H[5]); // ABEF
+    __m128i s1 = _mm_set_epi32(H[2], H[3], H[6], H[7]); // CDGH
+    __m128i w0, w1, w2, w3;
+    int i;
+
+    w0 = _mm_set_epi32(0, 0x80000000,
+        BSWAP32((uint32_t)(seed >> 32)), BSWAP32((uint32_t)(seed)));
+    w1 = _mm_setzero_si128();
+    w2 = _mm_setzero_si128();
+    w3 = _mm_set_epi32(0x00000040, 0, 0, 0);
+
+    SHA_ROUNDS4(g_sha256_k +  0, s0, s1, w0);
+    SHA_ROUNDS4(g_sha256_k +  4, s0, s1, w1);
+    SHA_ROUNDS4(g_sha256_k +  8, s0, s1, w2);
+    SHA_ROUNDS4(g_sha256_k + 12, s0, s1, w3);
+
+    for (i = 16; i < 64; i += 16)
+    {
+        SHA_SCHEDULE(w0, w1, w2, w3);
+        SHA_ROUNDS4(g_sha256_k + i +  0, s0, s1, w0);
+        SHA_SCHEDULE(w1, w2, w3, w0);
+        SHA_ROUNDS4(g_sha256_k + i +  4, s0, s1, w1);
+        SHA_SCHEDULE(w2, w3, w0, w1);
+        SHA_ROUNDS4(g_sha256_k + i +  8, s0, s1, w2);
+        SHA_SCHEDULE(w3, w0, w1, w2);
+        SHA_ROUNDS4(g_sha256_k + i + 12, s0, s1, w3);
+    }
+
+    uint32_t a0 = _mm_extract_epi32(s0, 3) + H[0];
+    uint32_t a1 = _mm_extract_epi32(s0, 2) + H[1];
+    return BSWAP32(a0) | ((uint64_t)BSWAP32(a1) << 32);
+}
+
+/* Eight hashes at once, with one seed in each 32-bit lane. */
+#define ROTR8(X, N) \
+    _mm256_or_si256(_mm256_srli_epi32(X, N), _mm256_slli_epi32(X, 32-(N)))
+
+ATTR(target("avx2"))
+static void getVoronoiSHAAVX2(uint64_t *sha, const uint64_t *seeds)
+{
+    __m256i m[64];
+    __m256i a0, a1, a2, a3, a4, a5, a6, a7, x, y;
+    uint32_t lo[8], hi[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        lo[i] = BSWAP32((uint32_t)(seeds[i]));
+        hi[i] = BSWAP32((uint32_t)(seeds[i] >> 32));
+    }
+    m[0] = _mm256_loadu_si256((const __m256i*) lo);
+    m[1] = _mm256_loadu_si256((const __m256i*) hi);
+    m[2] = _mm256_set1_epi32(0x80000000);
+    for (i = 3; i < 15; i++)
+        m[i] = _mm256_setzero_si256();
+    m[15] = _mm256_set1_epi32(0x00000040);
+
+    for (i = 16; i < 64; ++i)
+    {
+        x = m[i - 15];
+        y = m[i - 2];
+        x = _mm256_xor_si256(_mm256_xor_si256(ROTR8(x, 7), ROTR8(x, 18)),
+            _mm256_srli_epi32(x, 3));
+        y = _mm256_xor_si256(_mm256_xor_si256(ROTR8(y, 17), ROTR8(y, 19)),
+            _mm256_srli_epi32(y, 10));
+        m[i] = _mm256_add_epi32(_mm256_add_epi32(m[i - 7], m[i - 16]),
+            _mm256_add_epi32(x, y));
+    }
+
+    a0 = _mm256_set1_epi32(g_sha256_h[0]);
+    a1 = _mm256_set1_epi32(g_sha256_h[1]);
+    a2 = _mm256_set1_epi32(g_sha256_h[2]);
+    a3 = _mm256_set1_epi32(g_sha256_h[3]);
+    a4 = _mm256_set1_epi32(g_sha256_h[4]);
+    a5 = _mm256_set1_epi32(g_sha256_h[5]);
+    a6 = _mm256_set1_epi32(g_sha256_h[6]);
+    a7 = _mm256_set1_epi32(g_sha256_h[7]);
+
+    for (i = 0; i < 64; i++)
+    {
+        x = _mm256_add_epi32(_mm256_add_epi32(a7, m[i]),
+            _mm256_set1_epi32(g_sha256_k[i]));
+        x = _mm256_add_epi32(x, _mm256_xor_si256(
+            _mm256_xor_si256(ROTR8(a4, 6), ROTR8(a4, 11)), ROTR8(a4, 25)));
+        x = _mm256_add_epi32(x, _mm256_xor_si256(
+            _mm256_and_si256(a4, a5), _mm256_andnot_si256(a4, a6)));
+
+        y = _mm256_xor_si256(
+            _mm256_xor_si256(ROTR8(a0, 2), ROTR8(a0, 13)), ROTR8(a0, 22));
+        y = _mm256_add_epi32(y, _mm256_xor_si256(_mm256_and_si256(a0, a1),
+            _mm256_and_si256(a2, _mm256_xor_si256(a0, a1))));
+
+        a7 = a6;
+        a6 = a5;
+        a5 = a4;
+        a4 = _mm256_add_epi32(a3, x);
+        a3 = a2;
+        a2 = a1;
+        a1 = a0;
+        a0 = _mm256_add_epi32(x, y);
+    }
+
+    _mm256_storeu_si256((__m256i*) lo,
+        _mm256_add_epi32(a0, _mm256_set1_epi32(g_sha256_h[0])));
+    _mm256_storeu_si256((__m256i*) hi,
+        _mm256_add_epi32(a1, _mm256_set1_epi32(g_sha256_h[1])));
+    for (i = 0; i < 8; i++)
+        sha[i] = BSWAP32(lo[i]) | ((uint64_t)BSWAP32(hi[i]) << 32);
+}
+
+#endif // LAYER_SIMD_X86
+
+uint64_t getVoronoiSHA(uint64_t seed)
+{
+#if LAYER_SIMD_X86
+    if (__builtin_cpu_supports("sha"))
+        return getVoronoiSHANI(seed);
+#endif
+    return getVoronoiSHAScalar(seed);
+}
+
+void getVoronoiSHABatch(uint64_t *sha, const uint64_t *seeds, int n)
+{
+    int i = 0;
+#if LAYER_SIMD_X86
+    // the SHA extensions beat the eight lanes of AVX2 where both exist
+    if (!__builtin_cpu_supports("sha") && __builtin_cpu_supports("avx2"))
+    {
+        for (; i + 8 <= n; i += 8)
+            getVoronoiSHAAVX2(sha + i, seeds + i);
+    }
+#endif
+    for (; i < n; i++)
+        sha[i] = getVoronoiSHA(seeds[i]);
+}
+
 void voronoiAccess3D(uint64_t sha, int x, int y, int z, int *x4, int *y4, int *z4)
 {
     x -= 2;
@@ -2182,3 +3012,746 @@ void voronoiAccess3D(uint64_t sha, int x, int y, int z, int *x4, int *y4, int *z
 
 
 
+
+
+//==============================================================================
+// Seed Batches
+//==============================================================================
+
+void setLayerBatchSeeds(LayerBatch *lb, const LayerStack *g,
+        const uint64_t *seeds)
+{
+    uint64_t sha[LAYER_LANES];
+    int i, k, hashed = 0;
+
+    for (i = 0; i < L_NUM; i++)
+    {
+        uint64_t ls = g->layers[i].layerSalt;
+        if (ls == LAYER_INIT_SHA && !hashed)
+        {
+            getVoronoiSHABatch(sha, seeds, LAYER_LANES);
+            hashed = 1;
+        }
+        for (k = 0; k < LAYER_LANES; k++)
+        {
+            if (ls == 0)
+            {   // Pre 1.13 the Hills branch stays zero-initialized
+                lb->startSalt[i][k] = 0;
+                lb->startSeed[i][k] = 0;
+            }
+            else if (ls == LAYER_INIT_SHA)
+            {
+                lb->startSalt[i][k] = sha[k];
+                lb->startSeed[i][k] = 0;
+            }
+            else
+            {
+                uint64_t st = getStartSalt(seeds[k], ls);
+                lb->startSalt[i][k] = st;
+                lb->startSeed[i][k] = mcStepSeed(st, 0);
+            }
+        }
+    }
+}
+
+enum
+{
+    BATCH_CONTINENT, BATCH_ZOOM_FUZZY, BATCH_ZOOM, BATCH_LAND, BATCH_ISLAND,
+    BATCH_SNOW, BATCH_COOL, BATCH_HEAT, BATCH_SPECIAL, BATCH_MUSHROOM,
+    BATCH_DEEP_OCEAN, BATCH_BIOME, BATCH_BAMBOO,
+};
+
+/// A layer of the batch and the area it has to generate.
+STRUCT(BatchStep)
+{
+    int type;
+    int id;
+    int x, z, w, h;
+};
+
+static int getBatchType(const Layer *l)
+{
+    mapfunc_t *f = l->getMap;
+    if (f == mapContinent)  return BATCH_CONTINENT;
+    if (f == mapZoomFuzzy)  return BATCH_ZOOM_FUZZY;
+    if (f == mapZoom)       return BATCH_ZOOM;
+    if (f == mapLand)       return BATCH_LAND;
+    if (f == mapIsland)     return BATCH_ISLAND;
+    if (f == mapSnow)       return BATCH_SNOW;
+    if (f == mapCool)       return BATCH_COOL;
+    if (f == mapHeat)       return BATCH_HEAT;
+    if (f == mapSpecial)    return BATCH_SPECIAL;
+    if (f == mapMushroom)   return BATCH_MUSHROOM;
+    if (f == mapDeepOcean)  return BATCH_DEEP_OCEAN;
+    if (f == mapBiome && l->mc > MC_1_6) return BATCH_BIOME;
+    if (f == mapBamboo)     return BATCH_BAMBOO;
+    return -1;
+}
+
+#if LAYER_SIMD_X86
+
+/* The layers with the world seeds in the lanes of AVX-512 vectors: the 64-bit
+ * seeds fill a zmm register, and the 32-bit cell values a ymm register. The
+ * cells are evaluated without branching on the individual seeds, but the
+ * PRNG is skipped for a cell when none of the lanes need it.
+ */
+#define LOAD_LANES(P)       _mm256_loadu_si256((const __m256i*)(P))
+#define STORE_LANES(P, V)   _mm256_storeu_si256((__m256i*)(P), V)
+#define CELL(X, Z, W)       (((Z)*(int64_t)(W) + (X)) * LAYER_LANES)
+
+ATTR(target(AVX512_LAYER))
+static void mapContinentAVX512(const uint64_t *ss, int *out,
+        int x, int z, int w, int h)
+{
+    __m512i vss = _mm512_loadu_si512(ss);
+    const __m256i one = _mm256_set1_epi32(1);
+    int64_t i, j;
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            __m512i cs = chunkSeedAVX512(vss, i + x, j + z);
+            __mmask8 m = firstIsZeroAVX512(cs, 10);
+            STORE_LANES(out + CELL(i, j, w), _mm256_maskz_mov_epi32(m, one));
+        }
+    }
+
+    if (x > -w && x <= 0 && z > -h && z <= 0)
+    {
+        STORE_LANES(out + CELL(-x, -z, w), one);
+    }
+}
+
+ATTR(target(AVX512_LAYER))
+static void mapZoomAVX512(const uint64_t *st, const uint64_t *ss, int fuzzy,
+        int *out, int x, int z, int w, int h)
+{
+    int pX = x >> 1;
+    int pZ = z >> 1;
+    int64_t pW = ((x + w) >> 1) - pX + 1;
+    int64_t pH = ((z + h) >> 1) - pZ + 1;
+    int64_t newW = pW * 2;
+    int64_t i, j;
+
+    int *buf = out + pW * pH * LAYER_LANES;
+    const __m256i vst = _mm512_cvtepi64_epi32(_mm512_loadu_si512(st));
+    const __m256i vss = _mm512_cvtepi64_epi32(_mm512_loadu_si512(ss));
+    const __m256i mul = _mm256_set1_epi32(1284865837);
+    const __m256i add = _mm256_set1_epi32((int)4150755663U);
+    const __m256i bit24 = _mm256_set1_epi32(1 << 24);
+    const __m256i bit25 = _mm256_set1_epi32(1 << 25);
+
+#define ZOOM_STEP(cs) \
+    _mm256_mullo_epi32(cs, _mm256_add_epi32(_mm256_mullo_epi32(cs, mul), add))
+
+    // like mapZoom(), this reads one row and column past the parent area,
+    // which only affects cells that are not copied to the output
+    for (j = 0; j < pH; j++)
+    {
+        for (i = 0; i < pW; i++)
+        {
+            __m256i v00 = LOAD_LANES(out + CELL(i+0, j+0, pW));
+            __m256i v10 = LOAD_LANES(out + CELL(i+1, j+0, pW));
+            __m256i v01 = LOAD_LANES(out + CELL(i+0, j+1, pW));
+            __m256i v11 = LOAD_LANES(out + CELL(i+1, j+1, pW));
+            int *b0 = buf + CELL(i*2, j*2+0, newW);
+            int *b1 = buf + CELL(i*2, j*2+1, newW);
+
+            __mmask8 e10 = _mm256_cmpeq_epi32_mask(v00, v10);
+            __mmask8 e01 = _mm256_cmpeq_epi32_mask(v00, v01);
+            __mmask8 e11 = _mm256_cmpeq_epi32_mask(v00, v11);
+            if ((__mmask8)(e10 & e01 & e11) == 0xff)
+            {
+                STORE_LANES(b0, v00);
+                STORE_LANES(b0 + LAYER_LANES, v00);
+                STORE_LANES(b1, v00);
+                STORE_LANES(b1 + LAYER_LANES, v00);
+                continue;
+            }
+
+            __m256i chunkX = _mm256_set1_epi32((i + pX) * 2);
+            __m256i chunkZ = _mm256_set1_epi32((j + pZ) * 2);
+
+            __m256i cs = _mm256_add_epi32(vss, chunkX);
+            cs = _mm256_add_epi32(ZOOM_STEP(cs), chunkZ);
+            cs = _mm256_add_epi32(ZOOM_STEP(cs), chunkX);
+            cs = _mm256_add_epi32(ZOOM_STEP(cs), chunkZ);
+
+            STORE_LANES(b0, v00);
+            STORE_LANES(b1, _mm256_mask_blend_epi32(
+                _mm256_test_epi32_mask(cs, bit24), v00, v01));
+
+            cs = _mm256_add_epi32(ZOOM_STEP(cs), vst);
+            STORE_LANES(b0 + LAYER_LANES, _mm256_mask_blend_epi32(
+                _mm256_test_epi32_mask(cs, bit24), v00, v10));
+
+            cs = _mm256_add_epi32(ZOOM_STEP(cs), vst);
+            __mmask8 r0 = _mm256_test_epi32_mask(cs, bit24);
+            __mmask8 r1 = _mm256_test_epi32_mask(cs, bit25);
+            __m256i v = _mm256_mask_blend_epi32(r1,
+                _mm256_mask_blend_epi32(r0, v00, v10),
+                _mm256_mask_blend_epi32(r0, v01, v11));
+
+            if (!fuzzy)
+            {   // select4(), with the negated counts of equal neighbours
+                __m256i c00 = _mm256_add_epi32(_mm256_add_epi32(
+                    _mm256_cmpeq_epi32(v00, v10), _mm256_cmpeq_epi32(v00, v01)),
+                    _mm256_cmpeq_epi32(v00, v11));
+                __m256i c10 = _mm256_add_epi32(
+                    _mm256_cmpeq_epi32(v10, v01), _mm256_cmpeq_epi32(v10, v11));
+                __m256i c01 = _mm256_cmpeq_epi32(v01, v11);
+                __mmask8 s00 = _mm256_cmpgt_epi32_mask(c10, c00) &
+                    _mm256_cmpgt_epi32_mask(c01, c00);
+                __mmask8 s10 = _mm256_cmpgt_epi32_mask(c00, c10);
+                __mmask8 s01 = _mm256_cmpgt_epi32_mask(c00, c01);
+                v = _mm256_mask_mov_epi32(v, s01, v01);
+                v = _mm256_mask_mov_epi32(v, s10, v10);
+                v = _mm256_mask_mov_epi32(v, s00, v00);
+            }
+            STORE_LANES(b1 + LAYER_LANES, v);
+        }
+    }
+#undef ZOOM_STEP
+
+    for (j = 0; j < h; j++)
+    {
+        memmove(out + CELL(0, j, w), buf + CELL(x & 1, j + (z & 1), newW),
+            w * LAYER_LANES * sizeof(int));
+    }
+}
+
+ATTR(target(AVX512_LAYER))
+static void mapLandAVX512(const uint64_t *st, const uint64_t *ss,
+        int *out, int x, int z, int w, int h)
+{
+    int64_t pW = w + 2;
+    int64_t i, j;
+
+    const __m512i vst = _mm512_loadu_si512(st);
+    const __m512i vss = _mm512_loadu_si512(ss);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256i three = _mm256_set1_epi32(3);
+    const __m256i vforest = _mm256_set1_epi32(forest);
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            __m256i v00 = LOAD_LANES(out + CELL(i+0, j+0, pW));
+            __m256i v20 = LOAD_LANES(out + CELL(i+2, j+0, pW));
+            __m256i v11 = LOAD_LANES(out + CELL(i+1, j+1, pW));
+            __m256i v02 = LOAD_LANES(out + CELL(i+0, j+2, pW));
+            __m256i v22 = LOAD_LANES(out + CELL(i+2, j+2, pW));
+            __m256i v = v11;
+
+            __mmask8 n00 = _mm256_cmpneq_epi32_mask(v00, zero);
+            __mmask8 n20 = _mm256_cmpneq_epi32_mask(v20, zero);
+            __mmask8 n02 = _mm256_cmpneq_epi32_mask(v02, zero);
+            __mmask8 n22 = _mm256_cmpneq_epi32_mask(v22, zero);
+            __mmask8 o11 = _mm256_cmpeq_epi32_mask(v11, zero);
+            // ocean with non-ocean corners
+            __mmask8 sea = o11 & (n00 | n20 | n02 | n22);
+            // land (other than forest) with ocean corners
+            __mmask8 shore = ~o11 & ~(n00 & n20 & n02 & n22) &
+                _mm256_cmpneq_epi32_mask(v11, vforest);
+
+            if (sea | shore)
+            {
+                __m512i cs = chunkSeedAVX512(vss, i + x, j + z);
+
+                if (shore)
+                {
+                    __mmask8 m = shore & firstIsZeroAVX512(cs, 5);
+                    v = _mm256_mask_mov_epi32(v, m, zero);
+                }
+                if (sea)
+                {
+                    __m256i vs = one, inc = zero;
+                    __mmask8 m, c1, c2, c3;
+
+                    vs = _mm256_mask_mov_epi32(vs, n00, v00);
+                    inc = _mm256_mask_add_epi32(inc, n00, inc, one);
+                    cs = _mm512_mask_mov_epi64(cs, n00, stepSeedAVX512(cs, vst));
+
+                    inc = _mm256_mask_add_epi32(inc, n20, inc, one);
+                    c1 = _mm256_cmpeq_epi32_mask(inc, one);
+                    m = n20 & (c1 | firstIsZeroAVX512(cs, 2));
+                    vs = _mm256_mask_mov_epi32(vs, m, v20);
+                    cs = _mm512_mask_mov_epi64(cs, n20, stepSeedAVX512(cs, vst));
+
+                    inc = _mm256_mask_add_epi32(inc, n02, inc, one);
+                    c1 = _mm256_cmpeq_epi32_mask(inc, one);
+                    c2 = _mm256_cmpeq_epi32_mask(inc, two);
+                    m = c1 | (c2 & firstIsZeroAVX512(cs, 2)) |
+                        (~(c1 | c2) & firstIsZeroAVX512(cs, 3));
+                    vs = _mm256_mask_mov_epi32(vs, n02 & m, v02);
+                    cs = _mm512_mask_mov_epi64(cs, n02, stepSeedAVX512(cs, vst));
+
+                    inc = _mm256_mask_add_epi32(inc, n22, inc, one);
+                    c1 = _mm256_cmpeq_epi32_mask(inc, one);
+                    c2 = _mm256_cmpeq_epi32_mask(inc, two);
+                    c3 = _mm256_cmpeq_epi32_mask(inc, three);
+                    m = c1 | (c2 & firstIsZeroAVX512(cs, 2)) |
+                        (c3 & firstIsZeroAVX512(cs, 3)) |
+                        (~(c1 | c2 | c3) & firstIsZeroAVX512(cs, 4));
+                    vs = _mm256_mask_mov_epi32(vs, n22 & m, v22);
+                    cs = _mm512_mask_mov_epi64(cs, n22, stepSeedAVX512(cs, vst));
+
+                    m = _mm256_cmpeq_epi32_mask(vs, vforest) |
+                        firstIsZeroAVX512(cs, 3);
+                    v = _mm256_mask_mov_epi32(v, sea, _mm256_maskz_mov_epi32(m, vs));
+                }
+            }
+
+            STORE_LANES(out + CELL(i, j, w), v);
+        }
+    }
+}
+
+ATTR(target(AVX512_LAYER))
+static void mapIslandAVX512(const uint64_t *ss, int *out,
+        int x, int z, int w, int h)
+{
+    int64_t pW = w + 2;
+    int64_t i, j;
+
+    const __m512i vss = _mm512_loadu_si512(ss);
+    const __m256i one = _mm256_set1_epi32(1);
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            __m256i v11 = LOAD_LANES(out + CELL(i+1, j+1, pW));
+            __m256i a = _mm256_or_si256(v11, _mm256_or_si256(
+                _mm256_or_si256(LOAD_LANES(out + CELL(i+1, j+0, pW)),
+                                LOAD_LANES(out + CELL(i+2, j+1, pW))),
+                _mm256_or_si256(LOAD_LANES(out + CELL(i+0, j+1, pW)),
+                                LOAD_LANES(out + CELL(i+1, j+2, pW)))));
+            __mmask8 m = _mm256_cmpeq_epi32_mask(a, _mm256_setzero_si256());
+
+            if (m)
+            {
+                __m512i cs = chunkSeedAVX512(vss, i + x, j + z);
+                m &= firstIsZeroAVX512(cs, 2);
+                v11 = _mm256_mask_mov_epi32(v11, m, one);
+            }
+            STORE_LANES(out + CELL(i, j, w), v11);
+        }
+    }
+}
+
+ATTR(target(AVX512_LAYER))
+static void mapSnowAVX512(const uint64_t *ss, int *out,
+        int x, int z, int w, int h)
+{
+    int64_t pW = w + 2;
+    int64_t i, j;
+
+    const __m512i vss = _mm512_loadu_si512(ss);
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            __m256i v11 = LOAD_LANES(out + CELL(i+1, j+1, pW));
+            __mmask8 m = ~isAnyOfAVX512(v11, SHALLOW_OCEAN_BITS);
+
+            if (m)
+            {
+                __m512i cs = chunkSeedAVX512(vss, i + x, j + z);
+                __m256i r = firstIntAVX512i(cs, 6);
+                __m256i v = _mm256_set1_epi32(Warm);
+                v = _mm256_mask_mov_epi32(v, _mm256_cmpeq_epi32_mask(r,
+                    _mm256_set1_epi32(1)), _mm256_set1_epi32(Cold));
+                v = _mm256_mask_mov_epi32(v, _mm256_cmpeq_epi32_mask(r,
+                    _mm256_setzero_si256()), _mm256_set1_epi32(Freezing));
+                v11 = _mm256_mask_mov_epi32(v11, m, v);
+            }
+            STORE_LANES(out + CELL(i, j, w), v11);
+        }
+    }
+}
+
+/// mapCool() and mapHeat(): a cell of type 'from' next to any of the types
+/// 'a' or 'b' becomes 'to'.
+ATTR(target(AVX512_LAYER))
+static void mapClimateAVX512(int from, int a, int b, int to, int *out,
+        int w, int h)
+{
+    int64_t pW = w + 2;
+    int64_t i, j;
+
+    const __m256i va = _mm256_set1_epi32(a);
+    const __m256i vb = _mm256_set1_epi32(b);
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            __m256i v11 = LOAD_LANES(out + CELL(i+1, j+1, pW));
+            __mmask8 m = _mm256_cmpeq_epi32_mask(v11, _mm256_set1_epi32(from));
+
+            if (m)
+            {
+                __m256i v10 = LOAD_LANES(out + CELL(i+1, j+0, pW));
+                __m256i v21 = LOAD_LANES(out + CELL(i+2, j+1, pW));
+                __m256i v01 = LOAD_LANES(out + CELL(i+0, j+1, pW));
+                __m256i v12 = LOAD_LANES(out + CELL(i+1, j+2, pW));
+                __mmask8 c =
+                    _mm256_cmpeq_epi32_mask(v10, va) | _mm256_cmpeq_epi32_mask(v10, vb) |
+                    _mm256_cmpeq_epi32_mask(v21, va) | _mm256_cmpeq_epi32_mask(v21, vb) |
+                    _mm256_cmpeq_epi32_mask(v01, va) | _mm256_cmpeq_epi32_mask(v01, vb) |
+                    _mm256_cmpeq_epi32_mask(v12, va) | _mm256_cmpeq_epi32_mask(v12, vb);
+                v11 = _mm256_mask_mov_epi32(v11, m & c, _mm256_set1_epi32(to));
+            }
+            STORE_LANES(out + CELL(i, j, w), v11);
+        }
+    }
+}
+
+ATTR(target(AVX512_LAYER))
+static void mapSpecialAVX512(const uint64_t *st, const uint64_t *ss,
+        int *out, int x, int z, int w, int h)
+{
+    int64_t i, j;
+
+    const __m512i vst = _mm512_loadu_si512(st);
+    const __m512i vss = _mm512_loadu_si512(ss);
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            int *o = out + CELL(i, j, w);
+            __m256i v = LOAD_LANES(o);
+            __mmask8 m = _mm256_cmpneq_epi32_mask(v, _mm256_setzero_si256());
+
+            if (m)
+            {
+                __m512i cs = chunkSeedAVX512(vss, i + x, j + z);
+                m &= firstIsZeroAVX512(cs, 13);
+                if (m)
+                {
+                    cs = stepSeedAVX512(cs, vst);
+                    __m256i r = firstIntAVX512i(cs, 15);
+                    r = _mm256_slli_epi32(_mm256_add_epi32(r, _mm256_set1_epi32(1)), 8);
+                    r = _mm256_and_si256(r, _mm256_set1_epi32(0xf00));
+                    STORE_LANES(o, _mm256_mask_or_epi32(v, m, v, r));
+                }
+            }
+        }
+    }
+}
+
+ATTR(target(AVX512_LAYER))
+static void mapMushroomAVX512(const uint64_t *ss, int *out,
+        int x, int z, int w, int h)
+{
+    int64_t pW = w + 2;
+    int64_t i, j;
+
+    const __m512i vss = _mm512_loadu_si512(ss);
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            __m256i v11 = LOAD_LANES(out + CELL(i+1, j+1, pW));
+            __m256i a = _mm256_or_si256(v11, _mm256_or_si256(
+                _mm256_or_si256(LOAD_LANES(out + CELL(i+0, j+0, pW)),
+                                LOAD_LANES(out + CELL(i+2, j+0, pW))),
+                _mm256_or_si256(LOAD_LANES(out + CELL(i+0, j+2, pW)),
+                                LOAD_LANES(out + CELL(i+2, j+2, pW)))));
+            __mmask8 m = _mm256_cmpeq_epi32_mask(a, _mm256_setzero_si256());
+
+            if (m)
+            {
+                __m512i cs = chunkSeedAVX512(vss, i + x, j + z);
+                m &= firstIsZeroAVX512(cs, 100);
+                v11 = _mm256_mask_mov_epi32(v11, m,
+                    _mm256_set1_epi32(mushroom_fields));
+            }
+            STORE_LANES(out + CELL(i, j, w), v11);
+        }
+    }
+}
+
+ATTR(target(AVX512_LAYER))
+static void mapDeepOceanAVX512(int *out, int w, int h)
+{
+    int64_t pW = w + 2;
+    int64_t i, j;
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            __m256i v11 = LOAD_LANES(out + CELL(i+1, j+1, pW));
+            __mmask8 m = isAnyOfAVX512(v11, SHALLOW_OCEAN_BITS);
+
+            if (m)
+            {
+                m &= isAnyOfAVX512(LOAD_LANES(out + CELL(i+1, j+0, pW)), SHALLOW_OCEAN_BITS);
+                m &= isAnyOfAVX512(LOAD_LANES(out + CELL(i+2, j+1, pW)), SHALLOW_OCEAN_BITS);
+                m &= isAnyOfAVX512(LOAD_LANES(out + CELL(i+0, j+1, pW)), SHALLOW_OCEAN_BITS);
+                m &= isAnyOfAVX512(LOAD_LANES(out + CELL(i+1, j+2, pW)), SHALLOW_OCEAN_BITS);
+
+                __m256i d = _mm256_set1_epi32(deep_ocean);
+#define DEEPEN(S, D) \
+                d = _mm256_mask_mov_epi32(d, _mm256_cmpeq_epi32_mask(v11, \
+                    _mm256_set1_epi32(S)), _mm256_set1_epi32(D))
+                DEEPEN(warm_ocean, deep_warm_ocean);
+                DEEPEN(lukewarm_ocean, deep_lukewarm_ocean);
+                DEEPEN(cold_ocean, deep_cold_ocean);
+                DEEPEN(frozen_ocean, deep_frozen_ocean);
+#undef DEEPEN
+                v11 = _mm256_mask_mov_epi32(v11, m, d);
+            }
+            STORE_LANES(out + CELL(i, j, w), v11);
+        }
+    }
+}
+
+ATTR(target(AVX512_LAYER))
+static void mapBiomeAVX512(const uint64_t *ss, int *out,
+        int x, int z, int w, int h)
+{
+    int64_t i, j;
+
+    const __m512i vss = _mm512_loadu_si512(ss);
+    const __m256i high = _mm256_set1_epi32(0xf00);
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            int *o = out + CELL(i, j, w);
+            __m256i v = LOAD_LANES(o);
+            __mmask8 hb = _mm256_test_epi32_mask(v, high);
+            __m256i id = _mm256_andnot_si256(high, v);
+            __mmask8 keep = isAnyOfAVX512(id,
+                SHALLOW_OCEAN_BITS | DEEP_OCEAN_BITS | (1ULL << mushroom_fields));
+
+            if (keep != 0xff)
+            {
+                __m512i cs = chunkSeedAVX512(vss, i + x, j + z);
+                __m256i r6 = firstIntAVX512i(cs, 6);
+                __m256i r4 = firstIntAVX512i(cs, 4);
+                __mmask8 m;
+                __m256i b;
+
+                v = _mm256_set1_epi32(mushroom_fields);
+
+                m = _mm256_cmpeq_epi32_mask(id, _mm256_set1_epi32(Warm));
+                b = _mm256_mask_blend_epi32(firstIsZeroAVX512(cs, 3),
+                    _mm256_set1_epi32(wooded_badlands_plateau),
+                    _mm256_set1_epi32(badlands_plateau));
+                b = _mm256_mask_blend_epi32(hb,
+                    _mm256_i32gather_epi32(warmBiomes, r6, 4), b);
+                v = _mm256_mask_mov_epi32(v, m, b);
+
+                m = _mm256_cmpeq_epi32_mask(id, _mm256_set1_epi32(Lush));
+                b = _mm256_mask_blend_epi32(hb,
+                    _mm256_i32gather_epi32(lushBiomes, r6, 4),
+                    _mm256_set1_epi32(jungle));
+                v = _mm256_mask_mov_epi32(v, m, b);
+
+                m = _mm256_cmpeq_epi32_mask(id, _mm256_set1_epi32(Cold));
+                b = _mm256_mask_blend_epi32(hb,
+                    _mm256_i32gather_epi32(coldBiomes, r4, 4),
+                    _mm256_set1_epi32(giant_tree_taiga));
+                v = _mm256_mask_mov_epi32(v, m, b);
+
+                m = _mm256_cmpeq_epi32_mask(id, _mm256_set1_epi32(Freezing));
+                b = _mm256_i32gather_epi32(snowBiomes, r4, 4);
+                v = _mm256_mask_mov_epi32(v, m, b);
+            }
+            STORE_LANES(o, _mm256_mask_mov_epi32(v, keep, id));
+        }
+    }
+}
+
+ATTR(target(AVX512_LAYER))
+static void mapBambooAVX512(const uint64_t *ss, int *out,
+        int x, int z, int w, int h)
+{
+    int64_t i, j;
+
+    const __m512i vss = _mm512_loadu_si512(ss);
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            int *o = out + CELL(i, j, w);
+            __m256i v = LOAD_LANES(o);
+            __mmask8 m = _mm256_cmpeq_epi32_mask(v, _mm256_set1_epi32(jungle));
+
+            if (m)
+            {
+                __m512i cs = chunkSeedAVX512(vss, i + x, j + z);
+                m &= firstIsZeroAVX512(cs, 10);
+                STORE_LANES(o, _mm256_mask_mov_epi32(v, m,
+                    _mm256_set1_epi32(bamboo_jungle)));
+            }
+        }
+    }
+}
+
+static void genBatchAVX512(const LayerBatch *lb, const BatchStep *steps,
+        int n, int *out)
+{
+    int i;
+
+    for (i = n-1; i >= 0; i--)
+    {
+        const BatchStep *s = steps + i;
+        const uint64_t *st = lb->startSalt[s->id];
+        const uint64_t *ss = lb->startSeed[s->id];
+        int x = s->x, z = s->z, w = s->w, h = s->h;
+
+        switch (s->type)
+        {
+        case BATCH_CONTINENT:
+            mapContinentAVX512(ss, out, x, z, w, h);
+            break;
+        case BATCH_ZOOM_FUZZY:
+            mapZoomAVX512(st, ss, 1, out, x, z, w, h);
+            break;
+        case BATCH_ZOOM:
+            mapZoomAVX512(st, ss, 0, out, x, z, w, h);
+            break;
+        case BATCH_LAND:
+            mapLandAVX512(st, ss, out, x, z, w, h);
+            break;
+        case BATCH_ISLAND:
+            mapIslandAVX512(ss, out, x, z, w, h);
+            break;
+        case BATCH_SNOW:
+            mapSnowAVX512(ss, out, x, z, w, h);
+            break;
+        case BATCH_COOL:
+            mapClimateAVX512(Warm, Cold, Freezing, Lush, out, w, h);
+            break;
+        case BATCH_HEAT:
+            mapClimateAVX512(Freezing, Warm, Lush, Cold, out, w, h);
+            break;
+        case BATCH_SPECIAL:
+            mapSpecialAVX512(st, ss, out, x, z, w, h);
+            break;
+        case BATCH_MUSHROOM:
+            mapMushroomAVX512(ss, out, x, z, w, h);
+            break;
+        case BATCH_DEEP_OCEAN:
+            mapDeepOceanAVX512(out, w, h);
+            break;
+        case BATCH_BIOME:
+            mapBiomeAVX512(ss, out, x, z, w, h);
+            break;
+        case BATCH_BAMBOO:
+            mapBambooAVX512(ss, out, x, z, w, h);
+            break;
+        }
+    }
+}
+
+#endif // LAYER_SIMD_X86
+
+/// Without SIMD support the seeds are generated one after the other by the
+/// scalar layers, on a copy of the layers that holds the salts of the lane.
+static int genBatchScalar(const LayerStack *g, const LayerBatch *lb,
+        const BatchStep *steps, int n, int *out)
+{
+    Layer chain[L_NUM];
+    size_t len = steps[0].w * (size_t) steps[0].h;
+    int64_t i;
+    int k, err = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        chain[i] = g->layers[steps[i].id];
+        chain[i].p = i+1 < n ? &chain[i+1] : NULL;
+        if (i+1 < n)
+        {   // the parent area, and for zoom layers the expanded copy of it
+            size_t siz = steps[i+1].w * (size_t) steps[i+1].h;
+            if (steps[i].type == BATCH_ZOOM || steps[i].type == BATCH_ZOOM_FUZZY)
+                siz *= 5;
+            if (siz > len)
+                len = siz;
+        }
+    }
+
+    int *buf = (int*) malloc(len * sizeof(int));
+    if (!buf)
+        return -1;
+
+    for (k = 0; k < LAYER_LANES && !err; k++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            chain[i].startSalt = lb->startSalt[steps[i].id][k];
+            chain[i].startSeed = lb->startSeed[steps[i].id][k];
+        }
+        err = chain->getMap(chain, buf, steps->x, steps->z, steps->w, steps->h);
+        for (i = 0; i < steps->w * (int64_t) steps->h; i++)
+            out[i * LAYER_LANES + k] = buf[i];
+    }
+
+    free(buf);
+    return err;
+}
+
+int genLayerBatch(const LayerStack *g, const LayerBatch *lb,
+        const Layer *layer, int *out, int x, int z, int w, int h)
+{
+    BatchStep steps[L_NUM];
+    const Layer *l;
+    int n = 0;
+
+    // walk down to the continents, working out the area of each parent
+    for (l = layer; l; l = l->p)
+    {
+        BatchStep *s = steps + n++;
+        if (l < g->layers || l >= g->layers + L_NUM || l->p2)
+            return -1;
+        s->type = getBatchType(l);
+        if (s->type < 0)
+            return -1;
+        s->id = (int)(l - g->layers);
+        s->x = x; s->z = z; s->w = w; s->h = h;
+
+        switch (s->type)
+        {
+        case BATCH_ZOOM_FUZZY:
+        case BATCH_ZOOM:
+            w = ((x + w) >> 1) - (x >> 1) + 1;
+            h = ((z + h) >> 1) - (z >> 1) + 1;
+            x >>= 1;
+            z >>= 1;
+            break;
+        case BATCH_CONTINENT:
+        case BATCH_SPECIAL:
+        case BATCH_BIOME:
+        case BATCH_BAMBOO:
+            break;
+        default:
+            x -= 1; z -= 1; w += 2; h += 2;
+        }
+    }
+    if (steps[n-1].type != BATCH_CONTINENT)
+        return -1;
+
+#if LAYER_SIMD_X86
+    if (__builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vl"))
+    {
+        genBatchAVX512(lb, steps, n, out);
+        return 0;
+    }
+#endif
+    return genBatchScalar(g, lb, steps, n, out);
+}
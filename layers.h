@@ -121,6 +121,15 @@ STRUCT(LayerStack)
     PerlinNoise oceanRnd;
 };
 
+// Seed dependent salts of a layer stack for LAYER_LANES world seeds at once
+enum { LAYER_LANES = 8 };
+
+STRUCT(LayerBatch)
+{
+    uint64_t startSalt[L_NUM][LAYER_LANES];
+    uint64_t startSeed[L_NUM][LAYER_LANES];
+};
+
 
 #ifdef __cplusplus
 extern "C"
@@ -175,8 +184,11 @@ mapfunc_t mapVoronoi114;
 // Biome generation now stops at scale 1:4 OceanMix and voronoi is just an
 // access algorithm, mapping the 1:1 scale onto its 1:4 correspondent.
 // It is seeded by the first 8-bytes of the SHA-256 hash of the world seed.
+// The batch variant hashes n seeds, several at once in SIMD lanes if the CPU
+// has no SHA extensions.
 ATTR(const)
 uint64_t getVoronoiSHA(uint64_t worldSeed);
+void getVoronoiSHABatch(uint64_t *sha, const uint64_t *worldSeeds, int n);
 void voronoiAccess3D(uint64_t sha, int x, int y, int z, int *x4, int *y4, int *z4);
 
 // Applies a 2D voronoi mapping at height 'y' to a 'src' plane, where
@@ -184,6 +196,37 @@ void voronoiAccess3D(uint64_t sha, int x, int y, int z, int *x4, int *y4, int *z
 void mapVoronoiPlane(uint64_t sha, int *out, int *src,
     int x, int z, int w, int h, int y, int px, int pz, int pw, int ph);
 
+// Applies the 3D voronoi mapping to the 1:1 volume [x,y,z,w,sy,h] with the
+// same result as voronoiAccess3D() for each block. The 'src' volume has to
+// cover the corresponding 1:4 range (see getVoronoiSrcRange()), in the
+// same y-z-x order as the output.
+void mapVoronoi3D(uint64_t sha, int *out, const int *src,
+    int x, int y, int z, int w, int h, int sy);
+
+//==============================================================================
+// Seed Batches
+//==============================================================================
+
+/* The layers up to the 1:256 biomes of 1.7 - 1.17 only depend on the world
+ * seed through their salts, so the same area can be generated for
+ * LAYER_LANES seeds at once, with the seeds in SIMD lanes. This is meant for
+ * prefilters that test many seeds on a small area.
+ *
+ * setLayerBatchSeeds() applies the seeds to a batch for a layer stack that
+ * was set up with setupLayerStack() (the world seed of the stack itself is
+ * not used). genLayerBatch() then generates the layer, which has to belong
+ * to that stack, with the values of the seeds interleaved:
+ *   out[(j*w + i) * LAYER_LANES + lane]
+ * The buffer needs LAYER_LANES times the size that genArea() would need
+ * (see getMinLayerCacheSize()). The results are the same as from genArea()
+ * for each seed. Returns non-zero if the layer, or one of its parents, has no
+ * batch implementation, which is the case for the 1.6- stacks.
+ */
+void setLayerBatchSeeds(LayerBatch *lb, const LayerStack *g,
+        const uint64_t *seeds);
+int genLayerBatch(const LayerStack *g, const LayerBatch *lb,
+        const Layer *layer, int *out, int x, int z, int w, int h);
+
 
 #ifdef __cplusplus
 }
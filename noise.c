@@ -3,6 +3,8 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <float.h>
+#include <string.h>
 
 // grad()
 #if 0
@@ -258,13 +260,13 @@ void samplePerlinBeta17Terrain(const PerlinNoise *noise, double *v,
         if (yi == 0 || i2 != genFlag)
         {
             genFlag = i2;
-            int a1 = idx[i1]   + i2;
-            int b1 = idx[i1+1] + i2;
+            uint8_t a1 = idx[i1]   + i2;
+            uint8_t b1 = idx[i1+1] + i2;
 
-            int a2 = idx[a1]   + i3;
-            int a3 = idx[a1+1] + i3;
-            int b2 = idx[b1]   + i3;
-            int b3 = idx[b1+1] + i3;
+            uint8_t a2 = idx[a1]   + i3;
+            uint8_t a3 = idx[a1+1] + i3;
+            uint8_t b2 = idx[b1]   + i3;
+            uint8_t b3 = idx[b1+1] + i3;
 
             double m1 = indexedLerp(idx[a2],   d1,   d2,   d3);
             double l2 = indexedLerp(idx[b2],   d1-1, d2,   d3);
@@ -390,6 +392,16 @@ void octaveInitBeta(OctaveNoise *noise, uint64_t *seed, PerlinNoise *octaves,
 
 int xOctaveInit(OctaveNoise *noise, Xoroshiro *xr, PerlinNoise *octaves,
         const double *amplitudes, int omin, int len, int nmax)
+{
+    PerlinQueue q;
+    q.n = 0;
+    int n = xOctaveInitQueue(noise, xr, octaves, amplitudes, omin, len, nmax, &q);
+    xPerlinFlush(&q);
+    return n;
+}
+
+int xOctaveInitQueue(OctaveNoise *noise, Xoroshiro *xr, PerlinNoise *octaves,
+        const double *amplitudes, int omin, int len, int nmax, PerlinQueue *q)
 {
     static const uint64_t md5_octave_n[][2] = {
         {0xb198de63a8012672, 0x7b84cad43ef7b5a8}, // md5 "octave_-12"
@@ -434,7 +446,7 @@ int xOctaveInit(OctaveNoise *noise, Xoroshiro *xr, PerlinNoise *octaves,
         Xoroshiro pxr;
         pxr.lo = xlo ^ md5_octave_n[12 + omin + i][0];
         pxr.hi = xhi ^ md5_octave_n[12 + omin + i][1];
-        xPerlinInit(&octaves[n], &pxr);
+        xPerlinQueue(q, &octaves[n], &pxr);
         octaves[n].amplitude = amplitudes[i] * persist;
         octaves[n].lacunarity = lacuna;
         n++;
@@ -537,6 +549,18 @@ void doublePerlinInit(DoublePerlinNoise *noise, uint64_t *seed,
  */
 int xDoublePerlinInit(DoublePerlinNoise *noise, Xoroshiro *xr,
         PerlinNoise *octaves, const double *amplitudes, int omin, int len, int nmax)
+{
+    PerlinQueue q;
+    q.n = 0;
+    int n = xDoublePerlinInitQueue(noise, xr, octaves, amplitudes, omin, len,
+        nmax, &q);
+    xPerlinFlush(&q);
+    return n;
+}
+
+int xDoublePerlinInitQueue(DoublePerlinNoise *noise, Xoroshiro *xr,
+        PerlinNoise *octaves, const double *amplitudes, int omin, int len,
+        int nmax, PerlinQueue *q)
 {
     int i, n = 0, na = -1, nb = -1;
     if (nmax > 0)
@@ -544,8 +568,8 @@ int xDoublePerlinInit(DoublePerlinNoise *noise, Xoroshiro *xr,
         na = (nmax + 1) >> 1;
         nb = nmax - na;
     }
-    n += xOctaveInit(&noise->octA, xr, octaves+n, amplitudes, omin, len, na);
-    n += xOctaveInit(&noise->octB, xr, octaves+n, amplitudes, omin, len, nb);
+    n += xOctaveInitQueue(&noise->octA, xr, octaves+n, amplitudes, omin, len, na, q);
+    n += xOctaveInitQueue(&noise->octB, xr, octaves+n, amplitudes, omin, len, nb, q);
 
     // trim amplitudes of zero
     for (i = len-1; i >= 0 && amplitudes[i] == 0.0; i--)
@@ -571,3 +595,1090 @@ double sampleDoublePerlin(const DoublePerlinNoise *noise,
     return v * noise->amplitude;
 }
 
+
+
+//==============================================================================
+// Batch sampling
+//==============================================================================
+
+/* The batch samplers evaluate many points per call. On x86 with GCC/Clang
+ * the Perlin kernel has AVX2 and AVX-512 variants that are selected at run
+ * time. They perform the same operations in the same order as the scalar
+ * samplePerlin(), so the results are bit-identical. This does not hold if
+ * the scalar code is built with FMA contraction, so the vector kernels are
+ * disabled for such builds (e.g. -march=native on FMA capable machines).
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__)) && !defined(__FMA__)
+#define NOISE_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#define NOISE_BATCH 64
+
+/* Gradient selection of indexedLerp() as flags: the result is P + Q, where
+ * P is a (bit 0 clear) or b (bit 0 set), negated if bit 1 is set, and Q is
+ * b (bit 2 clear) or c (bit 2 set), negated if bit 3 is set.
+ */
+#define GRAD_FLAGS \
+    0, 2, 8, 10, 4, 6, 12, 14, 5, 7, 13, 15, 0, 7, 2, 15
+
+#if NOISE_SIMD_X86
+
+ATTR(target("avx2"))
+static inline __m256d gradAVX2(__m128i h, __m256d a, __m256d b, __m256d c)
+{
+    const __m128i tab = _mm_setr_epi8(GRAD_FLAGS);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256i f = _mm256_cvtepi32_epi64(
+        _mm_shuffle_epi8(tab, _mm_and_si128(h, _mm_set1_epi32(0xf))));
+    // blendv selects on the sign bit, so shift the flag bits up there
+    __m256d p = _mm256_blendv_pd(a, b, _mm256_castsi256_pd(_mm256_slli_epi64(f, 63)));
+    __m256d q = _mm256_blendv_pd(b, c, _mm256_castsi256_pd(_mm256_slli_epi64(f, 61)));
+    p = _mm256_xor_pd(p, _mm256_and_pd(sign, _mm256_castsi256_pd(_mm256_slli_epi64(f, 62))));
+    q = _mm256_xor_pd(q, _mm256_and_pd(sign, _mm256_castsi256_pd(_mm256_slli_epi64(f, 60))));
+    return _mm256_add_pd(p, q);
+}
+
+ATTR(target("avx2"))
+static inline __m256d lerpAVX2(__m256d part, __m256d from, __m256d to)
+{
+    return _mm256_add_pd(from, _mm256_mul_pd(part, _mm256_sub_pd(to, from)));
+}
+
+ATTR(target("avx2"))
+static inline __m256d fadeAVX2(__m256d d)
+{   // d*d*d * (d * (d*6.0-15.0) + 10.0)
+    __m256d d3 = _mm256_mul_pd(_mm256_mul_pd(d, d), d);
+    __m256d e = _mm256_sub_pd(_mm256_mul_pd(d, _mm256_set1_pd(6.0)), _mm256_set1_pd(15.0));
+    e = _mm256_add_pd(_mm256_mul_pd(d, e), _mm256_set1_pd(10.0));
+    return _mm256_mul_pd(d3, e);
+}
+
+/* Returns the number of points processed (a multiple of 4). With a plane,
+ * the points are sampled at y = 0 and y is not accessed.
+ */
+ATTR(target("avx2"))
+static int samplePerlinAVX2(const PerlinNoise *noise, const PerlinPlane *plane,
+        double *out, const double *x, const double *y, const double *z, int n)
+{
+    // the byte gathers read up to 3 bytes past d[255], which is still within
+    // the PerlinNoise struct
+    const int *idx = (const int*) noise->d;
+    const __m128i m8 = _mm_set1_epi32(0xff);
+    const __m256d one = _mm256_set1_pd(1.0);
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        __m256d d1 = _mm256_add_pd(_mm256_loadu_pd(x+i), _mm256_set1_pd(noise->a));
+        __m256d d3 = _mm256_add_pd(_mm256_loadu_pd(z+i), _mm256_set1_pd(noise->c));
+        __m256d i1 = _mm256_floor_pd(d1);
+        __m256d i3 = _mm256_floor_pd(d3);
+        d1 = _mm256_sub_pd(d1, i1);
+        d3 = _mm256_sub_pd(d3, i3);
+        __m128i h1 = _mm_and_si128(_mm256_cvttpd_epi32(i1), m8);
+        __m128i h3 = _mm_and_si128(_mm256_cvttpd_epi32(i3), m8);
+        __m256d t1 = fadeAVX2(d1);
+        __m256d t3 = fadeAVX2(d3);
+        __m256d d2, t2;
+        __m128i v2a, v2b, v3a, v3b;
+
+        if (plane)
+        {   // the first two lookup levels are folded into the plane
+            d2 = _mm256_set1_pd(noise->d2);
+            t2 = _mm256_set1_pd(noise->t2);
+            __m128i g = _mm_i32gather_epi32((const int*) plane->idx, h1, 4);
+            v2a = _mm_and_si128(_mm_add_epi32(g, h3), m8);
+            v2b = _mm_and_si128(_mm_add_epi32(_mm_srli_epi32(g, 8), h3), m8);
+            v3a = _mm_and_si128(_mm_add_epi32(_mm_srli_epi32(g, 16), h3), m8);
+            v3b = _mm_and_si128(_mm_add_epi32(_mm_srli_epi32(g, 24), h3), m8);
+        }
+        else
+        {
+            d2 = _mm256_add_pd(_mm256_loadu_pd(y+i), _mm256_set1_pd(noise->b));
+            __m256d i2 = _mm256_floor_pd(d2);
+            d2 = _mm256_sub_pd(d2, i2);
+            __m128i h2 = _mm_and_si128(_mm256_cvttpd_epi32(i2), m8);
+            t2 = fadeAVX2(d2);
+
+            // each gather yields {idx[k], idx[k+1]} in the low two bytes
+            __m128i g1 = _mm_i32gather_epi32(idx, h1, 1);
+            __m128i v1a = _mm_and_si128(_mm_add_epi32(g1, h2), m8);
+            __m128i v1b = _mm_and_si128(_mm_add_epi32(_mm_srli_epi32(g1, 8), h2), m8);
+            __m128i g2 = _mm_i32gather_epi32(idx, v1a, 1);
+            __m128i g3 = _mm_i32gather_epi32(idx, v1b, 1);
+            v2a = _mm_and_si128(_mm_add_epi32(g2, h3), m8);
+            v2b = _mm_and_si128(_mm_add_epi32(_mm_srli_epi32(g2, 8), h3), m8);
+            v3a = _mm_and_si128(_mm_add_epi32(g3, h3), m8);
+            v3b = _mm_and_si128(_mm_add_epi32(_mm_srli_epi32(g3, 8), h3), m8);
+        }
+        __m128i g4 = _mm_i32gather_epi32(idx, v2a, 1);
+        __m128i g5 = _mm_i32gather_epi32(idx, v2b, 1);
+        __m128i g6 = _mm_i32gather_epi32(idx, v3a, 1);
+        __m128i g7 = _mm_i32gather_epi32(idx, v3b, 1);
+
+        __m256d e1 = _mm256_sub_pd(d1, one);
+        __m256d e2 = _mm256_sub_pd(d2, one);
+        __m256d e3 = _mm256_sub_pd(d3, one);
+
+        __m256d l1 = gradAVX2(g4,                    d1, d2, d3);
+        __m256d l5 = gradAVX2(_mm_srli_epi32(g4, 8), d1, d2, e3);
+        __m256d l2 = gradAVX2(g6,                    e1, d2, d3);
+        __m256d l6 = gradAVX2(_mm_srli_epi32(g6, 8), e1, d2, e3);
+        __m256d l3 = gradAVX2(g5,                    d1, e2, d3);
+        __m256d l7 = gradAVX2(_mm_srli_epi32(g5, 8), d1, e2, e3);
+        __m256d l4 = gradAVX2(g7,                    e1, e2, d3);
+        __m256d l8 = gradAVX2(_mm_srli_epi32(g7, 8), e1, e2, e3);
+
+        l1 = lerpAVX2(t1, l1, l2);
+        l3 = lerpAVX2(t1, l3, l4);
+        l5 = lerpAVX2(t1, l5, l6);
+        l7 = lerpAVX2(t1, l7, l8);
+        l1 = lerpAVX2(t2, l1, l3);
+        l5 = lerpAVX2(t2, l5, l7);
+        _mm256_storeu_pd(out+i, lerpAVX2(t3, l1, l5));
+    }
+    return i;
+}
+
+// AVX-512F implies FMA support, so contraction has to be disabled explicitly
+#if defined(__clang__)
+#define ATTR_AVX512 ATTR(target("avx512f,avx2"))
+#else
+#define ATTR_AVX512 ATTR(target("avx512f,avx2"), optimize("fp-contract=off"))
+#endif
+
+ATTR_AVX512
+static inline __m512d gradAVX512(__m256i h, __m512d a, __m512d b, __m512d c)
+{
+    const __m256i tab = _mm256_setr_epi8(GRAD_FLAGS, GRAD_FLAGS);
+    __m512i f = _mm512_cvtepi32_epi64(
+        _mm256_shuffle_epi8(tab, _mm256_and_si256(h, _mm256_set1_epi32(0xf))));
+    __mmask8 pb = _mm512_test_epi64_mask(f, _mm512_set1_epi64(1));
+    __mmask8 qc = _mm512_test_epi64_mask(f, _mm512_set1_epi64(4));
+    __m512i p = _mm512_castpd_si512(_mm512_mask_blend_pd(pb, a, b));
+    __m512i q = _mm512_castpd_si512(_mm512_mask_blend_pd(qc, b, c));
+    const __m512i sign = _mm512_set1_epi64(INT64_MIN);
+    p = _mm512_xor_si512(p, _mm512_and_si512(sign, _mm512_slli_epi64(f, 62)));
+    q = _mm512_xor_si512(q, _mm512_and_si512(sign, _mm512_slli_epi64(f, 60)));
+    return _mm512_add_pd(_mm512_castsi512_pd(p), _mm512_castsi512_pd(q));
+}
+
+ATTR_AVX512
+static inline __m512d lerpAVX512(__m512d part, __m512d from, __m512d to)
+{
+    return _mm512_add_pd(from, _mm512_mul_pd(part, _mm512_sub_pd(to, from)));
+}
+
+ATTR_AVX512
+static inline __m512d fadeAVX512(__m512d d)
+{
+    __m512d d3 = _mm512_mul_pd(_mm512_mul_pd(d, d), d);
+    __m512d e = _mm512_sub_pd(_mm512_mul_pd(d, _mm512_set1_pd(6.0)), _mm512_set1_pd(15.0));
+    e = _mm512_add_pd(_mm512_mul_pd(d, e), _mm512_set1_pd(10.0));
+    return _mm512_mul_pd(d3, e);
+}
+
+/* Returns the number of points processed (a multiple of 8). */
+ATTR_AVX512
+static int samplePerlinAVX512(const PerlinNoise *noise, const PerlinPlane *plane,
+        double *out, const double *x, const double *y, const double *z, int n)
+{
+    const int *idx = (const int*) noise->d;
+    const __m256i m8 = _mm256_set1_epi32(0xff);
+    const __m512d one = _mm512_set1_pd(1.0);
+    enum { rdn = _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC };
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m512d d1 = _mm512_add_pd(_mm512_loadu_pd(x+i), _mm512_set1_pd(noise->a));
+        __m512d d3 = _mm512_add_pd(_mm512_loadu_pd(z+i), _mm512_set1_pd(noise->c));
+        __m512d i1 = _mm512_roundscale_pd(d1, rdn);
+        __m512d i3 = _mm512_roundscale_pd(d3, rdn);
+        d1 = _mm512_sub_pd(d1, i1);
+        d3 = _mm512_sub_pd(d3, i3);
+        __m256i h1 = _mm256_and_si256(_mm512_cvttpd_epi32(i1), m8);
+        __m256i h3 = _mm256_and_si256(_mm512_cvttpd_epi32(i3), m8);
+        __m512d t1 = fadeAVX512(d1);
+        __m512d t3 = fadeAVX512(d3);
+        __m512d d2, t2;
+        __m256i v2a, v2b, v3a, v3b;
+
+        if (plane)
+        {
+            d2 = _mm512_set1_pd(noise->d2);
+            t2 = _mm512_set1_pd(noise->t2);
+            __m256i g = _mm256_i32gather_epi32((const int*) plane->idx, h1, 4);
+            v2a = _mm256_and_si256(_mm256_add_epi32(g, h3), m8);
+            v2b = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(g, 8), h3), m8);
+            v3a = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(g, 16), h3), m8);
+            v3b = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(g, 24), h3), m8);
+        }
+        else
+        {
+            d2 = _mm512_add_pd(_mm512_loadu_pd(y+i), _mm512_set1_pd(noise->b));
+            __m512d i2 = _mm512_roundscale_pd(d2, rdn);
+            d2 = _mm512_sub_pd(d2, i2);
+            __m256i h2 = _mm256_and_si256(_mm512_cvttpd_epi32(i2), m8);
+            t2 = fadeAVX512(d2);
+
+            __m256i g1 = _mm256_i32gather_epi32(idx, h1, 1);
+            __m256i v1a = _mm256_and_si256(_mm256_add_epi32(g1, h2), m8);
+            __m256i v1b = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(g1, 8), h2), m8);
+            __m256i g2 = _mm256_i32gather_epi32(idx, v1a, 1);
+            __m256i g3 = _mm256_i32gather_epi32(idx, v1b, 1);
+            v2a = _mm256_and_si256(_mm256_add_epi32(g2, h3), m8);
+            v2b = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(g2, 8), h3), m8);
+            v3a = _mm256_and_si256(_mm256_add_epi32(g3, h3), m8);
+            v3b = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(g3, 8), h3), m8);
+        }
+        __m256i g4 = _mm256_i32gather_epi32(idx, v2a, 1);
+        __m256i g5 = _mm256_i32gather_epi32(idx, v2b, 1);
+        __m256i g6 = _mm256_i32gather_epi32(idx, v3a, 1);
+        __m256i g7 = _mm256_i32gather_epi32(idx, v3b, 1);
+
+        __m512d e1 = _mm512_sub_pd(d1, one);
+        __m512d e2 = _mm512_sub_pd(d2, one);
+        __m512d e3 = _mm512_sub_pd(d3, one);
+
+        __m512d l1 = gradAVX512(g4,                       d1, d2, d3);
+        __m512d l5 = gradAVX512(_mm256_srli_epi32(g4, 8), d1, d2, e3);
+        __m512d l2 = gradAVX512(g6,                       e1, d2, d3);
+        __m512d l6 = gradAVX512(_mm256_srli_epi32(g6, 8), e1, d2, e3);
+        __m512d l3 = gradAVX512(g5,                       d1, e2, d3);
+        __m512d l7 = gradAVX512(_mm256_srli_epi32(g5, 8), d1, e2, e3);
+        __m512d l4 = gradAVX512(g7,                       e1, e2, d3);
+        __m512d l8 = gradAVX512(_mm256_srli_epi32(g7, 8), e1, e2, e3);
+
+        l1 = lerpAVX512(t1, l1, l2);
+        l3 = lerpAVX512(t1, l3, l4);
+        l5 = lerpAVX512(t1, l5, l6);
+        l7 = lerpAVX512(t1, l7, l8);
+        l1 = lerpAVX512(t2, l1, l3);
+        l5 = lerpAVX512(t2, l5, l7);
+        _mm512_storeu_pd(out+i, lerpAVX512(t3, l1, l5));
+    }
+    return i;
+}
+
+#endif // NOISE_SIMD_X86
+
+void samplePerlinBatch(const PerlinNoise *noise, double *out,
+        const double *x, const double *y, const double *z, int n)
+{
+    int i = 0;
+#if NOISE_SIMD_X86
+    if (n >= 8 && __builtin_cpu_supports("avx512f"))
+        i = samplePerlinAVX512(noise, NULL, out, x, y, z, n);
+    if (n - i >= 4 && __builtin_cpu_supports("avx2"))
+        i += samplePerlinAVX2(noise, NULL, out+i, x+i, y+i, z+i, n-i);
+#endif
+    for (; i < n; i++)
+        out[i] = samplePerlin(noise, x[i], y[i], z[i], 0, 0);
+}
+
+void sampleOctaveBatch(const OctaveNoise *noise, double *out,
+        const double *x, const double *y, const double *z, int n)
+{
+    double ax[NOISE_BATCH], ay[NOISE_BATCH], az[NOISE_BATCH], pv[NOISE_BATCH];
+    int b, i, j, m;
+
+    for (b = 0; b < n; b += m)
+    {
+        m = n - b < NOISE_BATCH ? n - b : NOISE_BATCH;
+        for (i = 0; i < m; i++)
+            out[b+i] = 0;
+        for (j = 0; j < noise->octcnt; j++)
+        {
+            const PerlinNoise *p = noise->octaves + j;
+            double lf = p->lacunarity;
+            for (i = 0; i < m; i++)
+            {
+                ax[i] = maintainPrecision(x[b+i] * lf);
+                ay[i] = maintainPrecision(y[b+i] * lf);
+                az[i] = maintainPrecision(z[b+i] * lf);
+            }
+            samplePerlinBatch(p, pv, ax, ay, az, m);
+            for (i = 0; i < m; i++)
+                out[b+i] += p->amplitude * pv[i];
+        }
+    }
+}
+
+void sampleDoublePerlinBatch(const DoublePerlinNoise *noise, double *out,
+        const double *x, const double *y, const double *z, int n)
+{
+    const double f = 337.0 / 331.0;
+    double fx[NOISE_BATCH], fy[NOISE_BATCH], fz[NOISE_BATCH];
+    double va[NOISE_BATCH], vb[NOISE_BATCH];
+    int b, i, m;
+
+    for (b = 0; b < n; b += m)
+    {
+        m = n - b < NOISE_BATCH ? n - b : NOISE_BATCH;
+        for (i = 0; i < m; i++)
+        {
+            fx[i] = x[b+i] * f;
+            fy[i] = y[b+i] * f;
+            fz[i] = z[b+i] * f;
+        }
+        sampleOctaveBatch(&noise->octA, va, x+b, y+b, z+b, m);
+        sampleOctaveBatch(&noise->octB, vb, fx, fy, fz, m);
+        for (i = 0; i < m; i++)
+        {   // same summation as sampleDoublePerlin()
+            double v = 0;
+            v += va[i];
+            v += vb[i];
+            out[b+i] = v * noise->amplitude;
+        }
+    }
+}
+
+
+
+//==============================================================================
+// Sampling at y = 0
+//==============================================================================
+
+/* Most climate parameters are sampled at y = 0, where the y terms of each
+ * octave are constant: d2, t2 and h2 are precomputed by the initialisation
+ * and the first two levels of permutation lookups only depend on h1. A
+ * PerlinPlane caches those as {idx[a1], idx[a1+1], idx[b1], idx[b1+1]}.
+ */
+
+static inline uint32_t planeLookup(const PerlinNoise *noise, int h1)
+{
+    const uint8_t *idx = noise->d;
+    uint8_t a1 = idx[h1]   + noise->h2;
+    uint8_t b1 = idx[h1+1] + noise->h2;
+    return idx[a1] | (idx[a1+1] << 8) | (idx[b1] << 16) |
+        ((uint32_t)idx[b1+1] << 24);
+}
+
+void perlinPlaneInit(PerlinPlane *plane, const PerlinNoise *noise)
+{
+    int i;
+    for (i = 0; i < 256; i++)
+        plane->idx[i] = planeLookup(noise, i);
+}
+
+int octavePlaneInit(PerlinPlane *planes, const OctaveNoise *noise)
+{
+    int i;
+    for (i = 0; i < noise->octcnt; i++)
+        perlinPlaneInit(planes + i, noise->octaves + i);
+    return noise->octcnt;
+}
+
+int doublePerlinPlaneInit(PerlinPlane *planes, const DoublePerlinNoise *noise)
+{
+    int n = octavePlaneInit(planes, &noise->octA);
+    return n + octavePlaneInit(planes + n, &noise->octB);
+}
+
+double samplePerlin2D(const PerlinNoise *noise, const PerlinPlane *plane,
+        double d1, double d3)
+{
+    uint8_t h1, h3;
+    double t1, t3;
+    double d2 = noise->d2;
+    double t2 = noise->t2;
+
+    d1 += noise->a;
+    d3 += noise->c;
+
+    double i1 = floor(d1);
+    double i3 = floor(d3);
+    d1 -= i1;
+    d3 -= i3;
+
+    h1 = (int) i1;
+    h3 = (int) i3;
+
+    t1 = d1*d1*d1 * (d1 * (d1*6.0-15.0) + 10.0);
+    t3 = d3*d3*d3 * (d3 * (d3*6.0-15.0) + 10.0);
+
+    const uint8_t *idx = noise->d;
+    uint32_t p = plane ? plane->idx[h1] : planeLookup(noise, h1);
+
+    uint8_t a2 = (uint8_t)(p)       + h3;
+    uint8_t a3 = (uint8_t)(p >> 8)  + h3;
+    uint8_t b2 = (uint8_t)(p >> 16) + h3;
+    uint8_t b3 = (uint8_t)(p >> 24) + h3;
+
+    double l1 = indexedLerp(idx[a2],   d1,   d2,   d3);
+    double l2 = indexedLerp(idx[b2],   d1-1, d2,   d3);
+    double l3 = indexedLerp(idx[a3],   d1,   d2-1, d3);
+    double l4 = indexedLerp(idx[b3],   d1-1, d2-1, d3);
+    double l5 = indexedLerp(idx[a2+1], d1,   d2,   d3-1);
+    double l6 = indexedLerp(idx[b2+1], d1-1, d2,   d3-1);
+    double l7 = indexedLerp(idx[a3+1], d1,   d2-1, d3-1);
+    double l8 = indexedLerp(idx[b3+1], d1-1, d2-1, d3-1);
+
+    l1 = lerp(t1, l1, l2);
+    l3 = lerp(t1, l3, l4);
+    l5 = lerp(t1, l5, l6);
+    l7 = lerp(t1, l7, l8);
+
+    l1 = lerp(t2, l1, l3);
+    l5 = lerp(t2, l5, l7);
+
+    return lerp(t3, l1, l5);
+}
+
+double sampleOctave2D(const OctaveNoise *noise, const PerlinPlane *planes,
+        double x, double z)
+{
+    double v = 0;
+    int i;
+    for (i = 0; i < noise->octcnt; i++)
+    {
+        PerlinNoise *p = noise->octaves + i;
+        double lf = p->lacunarity;
+        double ax = maintainPrecision(x * lf);
+        double az = maintainPrecision(z * lf);
+        double pv = samplePerlin2D(p, planes ? planes + i : NULL, ax, az);
+        v += p->amplitude * pv;
+    }
+    return v;
+}
+
+double sampleDoublePerlin2D(const DoublePerlinNoise *noise,
+        const PerlinPlane *planes, double x, double z)
+{
+    const double f = 337.0 / 331.0;
+    double v = 0;
+
+    v += sampleOctave2D(&noise->octA, planes, x, z);
+    v += sampleOctave2D(&noise->octB, planes ? planes + noise->octA.octcnt : NULL,
+            x*f, z*f);
+
+    return v * noise->amplitude;
+}
+
+void samplePerlinBatch2D(const PerlinNoise *noise, const PerlinPlane *plane,
+        double *out, const double *x, const double *z, int n)
+{
+    int i = 0;
+#if NOISE_SIMD_X86
+    if (plane)
+    {
+        if (n >= 8 && __builtin_cpu_supports("avx512f"))
+            i = samplePerlinAVX512(noise, plane, out, x, NULL, z, n);
+        if (n - i >= 4 && __builtin_cpu_supports("avx2"))
+            i += samplePerlinAVX2(noise, plane, out+i, x+i, NULL, z+i, n-i);
+    }
+    else
+    {   // without a plane the general kernels do the full lookups
+        static const double zero[NOISE_BATCH];
+        int m;
+        for (; i < n; i += m)
+        {
+            m = n - i < NOISE_BATCH ? n - i : NOISE_BATCH;
+            samplePerlinBatch(noise, out+i, x+i, zero, z+i, m);
+        }
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = samplePerlin2D(noise, plane, x[i], z[i]);
+}
+
+void sampleOctaveBatch2D(const OctaveNoise *noise, const PerlinPlane *planes,
+        double *out, const double *x, const double *z, int n)
+{
+    double ax[NOISE_BATCH], az[NOISE_BATCH], pv[NOISE_BATCH];
+    int b, i, j, m;
+
+    for (b = 0; b < n; b += m)
+    {
+        m = n - b < NOISE_BATCH ? n - b : NOISE_BATCH;
+        for (i = 0; i < m; i++)
+            out[b+i] = 0;
+        for (j = 0; j < noise->octcnt; j++)
+        {
+            const PerlinNoise *p = noise->octaves + j;
+            double lf = p->lacunarity;
+            for (i = 0; i < m; i++)
+            {
+                ax[i] = maintainPrecision(x[b+i] * lf);
+                az[i] = maintainPrecision(z[b+i] * lf);
+            }
+            samplePerlinBatch2D(p, planes ? planes + j : NULL, pv, ax, az, m);
+            for (i = 0; i < m; i++)
+                out[b+i] += p->amplitude * pv[i];
+        }
+    }
+}
+
+void sampleDoublePerlinBatch2D(const DoublePerlinNoise *noise,
+        const PerlinPlane *planes, double *out, const double *x, const double *z,
+        int n)
+{
+    const double f = 337.0 / 331.0;
+    const PerlinPlane *planesB = planes ? planes + noise->octA.octcnt : NULL;
+    double fx[NOISE_BATCH], fz[NOISE_BATCH];
+    double va[NOISE_BATCH], vb[NOISE_BATCH];
+    int b, i, m;
+
+    for (b = 0; b < n; b += m)
+    {
+        m = n - b < NOISE_BATCH ? n - b : NOISE_BATCH;
+        for (i = 0; i < m; i++)
+        {
+            fx[i] = x[b+i] * f;
+            fz[i] = z[b+i] * f;
+        }
+        sampleOctaveBatch2D(&noise->octA, planes, va, x+b, z+b, m);
+        sampleOctaveBatch2D(&noise->octB, planesB, vb, fx, fz, m);
+        for (i = 0; i < m; i++)
+        {
+            double v = 0;
+            v += va[i];
+            v += vb[i];
+            out[b+i] = v * noise->amplitude;
+        }
+    }
+}
+
+
+
+//==============================================================================
+// Bounded sampling
+//==============================================================================
+
+/* The magnitude of an improved Perlin noise sample is at most about 1.0363
+ * for any gradient arrangement, so each octave can change the sum by at most
+ * its amplitude times this bound (rounded up here).
+ */
+#define PERLIN_MAX 1.04
+
+int sampleDoublePerlinBounded(const DoublePerlinNoise *noise,
+        NoiseBoundStats *stats, double x, double y, double z,
+        double lo, double hi, double *v)
+{
+    enum { NMAX = 64 };
+    const double f = 337.0 / 331.0;
+    const OctaveNoise *oct[2] = { &noise->octA, &noise->octB };
+    double pos[2][3] = { {x, y, z}, {x*f, y*f, z*f} };
+    double pv[2][NMAX];
+    double rest = 0, sum = 0, amp = noise->amplitude;
+    int na = noise->octA.octcnt, nb = noise->octB.octcnt;
+    int i[2] = {0, 0};
+    int j, k, cmp = 0;
+
+    if (na > NMAX || nb > NMAX)
+    {
+        double s = sampleDoublePerlin(noise, x, y, z);
+        if (v) *v = s;
+        return s < lo ? -1 : s > hi ? +1 : 0;
+    }
+
+    for (k = 0; k < 2; k++)
+        for (j = 0; j < oct[k]->octcnt; j++)
+            rest += fabs(oct[k]->octaves[j].amplitude) * PERLIN_MAX;
+
+    while (i[0] < na || i[1] < nb)
+    {   // continue with the larger of the next octaves of A and B
+        k = i[1] >= nb || (i[0] < na &&
+            fabs(oct[0]->octaves[i[0]].amplitude) >=
+            fabs(oct[1]->octaves[i[1]].amplitude)) ? 0 : 1;
+        const PerlinNoise *p = oct[k]->octaves + i[k];
+        double lf = p->lacunarity;
+        double ax = maintainPrecision(pos[k][0] * lf);
+        double ay = maintainPrecision(pos[k][1] * lf);
+        double az = maintainPrecision(pos[k][2] * lf);
+        pv[k][i[k]] = samplePerlin(p, ax, ay, az, 0, 0);
+        sum += p->amplitude * pv[k][i[k]];
+        rest -= fabs(p->amplitude) * PERLIN_MAX;
+        i[k]++;
+
+        // allow for the rounding of the sums, which is orders below this
+        double eps = 1e-9 * (fabs(sum) + rest + 1.0);
+        double vmin = (sum - rest - eps) * amp;
+        double vmax = (sum + rest + eps) * amp;
+        if (amp < 0)
+        {
+            double tmp = vmin; vmin = vmax; vmax = tmp;
+        }
+        if (vmax < lo)
+            cmp = -1;
+        else if (vmin > hi)
+            cmp = +1;
+        else
+            continue;
+        break;
+    }
+
+    if (stats)
+    {
+        int n = i[0] + i[1];
+        stats->samples++;
+        stats->octaves += n;
+        stats->skipped += na + nb - n;
+    }
+    if (cmp)
+        return cmp;
+
+    // all octaves were sampled: sum them up as in sampleDoublePerlin()
+    double va = 0, vb = 0, s = 0;
+    for (j = 0; j < na; j++)
+        va += oct[0]->octaves[j].amplitude * pv[0][j];
+    for (j = 0; j < nb; j++)
+        vb += oct[1]->octaves[j].amplitude * pv[1][j];
+    s += va;
+    s += vb;
+    s *= amp;
+    if (v) *v = s;
+    return s < lo ? -1 : s > hi ? +1 : 0;
+}
+
+
+
+//==============================================================================
+// Approximate sampling
+//==============================================================================
+
+/* The approximate samplers reduce the coordinates to the lattice cell, the
+ * offset within it and its fade in double precision, exactly as
+ * samplePerlin() does, so the permutation lookups are the same. Only the
+ * gradients and the interpolation are evaluated in single precision.
+ *
+ * With the float unit roundoff u = 2^-24, the rounded offsets are accurate to
+ * u and their complements d-1 to 2u, so a gradient a+b (|a+b| <= 2) is off by
+ * at most 6u. The rounded fades are off by at most u, and a float lerp
+ * between values of magnitude <= 2 adds at most 14u to the larger error of
+ * its ends. After the three lerp levels this gives 48u < PERLIN_F_ERR.
+ */
+
+static inline float gradF(uint8_t h, float a, float b, float c)
+{
+    static const uint8_t flags[16] = { GRAD_FLAGS };
+    int f = flags[h & 0xf];
+    float p = (f & 1) ? b : a;
+    float q = (f & 4) ? c : b;
+    if (f & 2) p = -p;
+    if (f & 8) q = -q;
+    return p + q;
+}
+
+static inline float lerpF(float part, float from, float to)
+{
+    return from + part * (to - from);
+}
+
+static float samplePerlinF(const PerlinNoise *noise,
+        double x, double y, double z)
+{
+    x += noise->a;
+    y += noise->b;
+    z += noise->c;
+    double i1 = floor(x);
+    double i2 = floor(y);
+    double i3 = floor(z);
+    uint8_t h1 = (int) i1;
+    uint8_t h2 = (int) i2;
+    uint8_t h3 = (int) i3;
+    x -= i1;
+    y -= i2;
+    z -= i3;
+    float d1 = (float) x;
+    float d2 = (float) y;
+    float d3 = (float) z;
+    float t1 = (float) (x*x*x * (x * (x*6.0-15.0) + 10.0));
+    float t2 = (float) (y*y*y * (y * (y*6.0-15.0) + 10.0));
+    float t3 = (float) (z*z*z * (z * (z*6.0-15.0) + 10.0));
+
+    const uint8_t *idx = noise->d;
+    uint8_t a1 = idx[h1]   + h2;
+    uint8_t b1 = idx[h1+1] + h2;
+    uint8_t a2 = idx[a1]   + h3;
+    uint8_t b2 = idx[b1]   + h3;
+    uint8_t a3 = idx[a1+1] + h3;
+    uint8_t b3 = idx[b1+1] + h3;
+
+    float l1 = gradF(idx[a2],   d1,   d2,   d3);
+    float l2 = gradF(idx[b2],   d1-1, d2,   d3);
+    float l3 = gradF(idx[a3],   d1,   d2-1, d3);
+    float l4 = gradF(idx[b3],   d1-1, d2-1, d3);
+    float l5 = gradF(idx[a2+1], d1,   d2,   d3-1);
+    float l6 = gradF(idx[b2+1], d1-1, d2,   d3-1);
+    float l7 = gradF(idx[a3+1], d1,   d2-1, d3-1);
+    float l8 = gradF(idx[b3+1], d1-1, d2-1, d3-1);
+
+    l1 = lerpF(t1, l1, l2);
+    l3 = lerpF(t1, l3, l4);
+    l5 = lerpF(t1, l5, l6);
+    l7 = lerpF(t1, l7, l8);
+    l1 = lerpF(t2, l1, l3);
+    l5 = lerpF(t2, l5, l7);
+    return lerpF(t3, l1, l5);
+}
+
+#if NOISE_SIMD_X86
+
+ATTR(target("avx2"))
+static inline __m256 gradAVX2F(__m256i h, __m256 a, __m256 b, __m256 c)
+{
+    const __m256i tab = _mm256_setr_epi8(GRAD_FLAGS, GRAD_FLAGS);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256i f = _mm256_shuffle_epi8(tab, _mm256_and_si256(h, _mm256_set1_epi32(0xf)));
+    __m256 p = _mm256_blendv_ps(a, b, _mm256_castsi256_ps(_mm256_slli_epi32(f, 31)));
+    __m256 q = _mm256_blendv_ps(b, c, _mm256_castsi256_ps(_mm256_slli_epi32(f, 29)));
+    p = _mm256_xor_ps(p, _mm256_and_ps(sign, _mm256_castsi256_ps(_mm256_slli_epi32(f, 30))));
+    q = _mm256_xor_ps(q, _mm256_and_ps(sign, _mm256_castsi256_ps(_mm256_slli_epi32(f, 28))));
+    return _mm256_add_ps(p, q);
+}
+
+ATTR(target("avx2"))
+static inline __m256 lerpAVX2F(__m256 part, __m256 from, __m256 to)
+{
+    return _mm256_add_ps(from, _mm256_mul_ps(part, _mm256_sub_ps(to, from)));
+}
+
+/* Splits 8 coordinates into the 8-bit cell index, the float cell offset and
+ * its fade, which is evaluated in double precision before rounding.
+ */
+ATTR(target("avx2"))
+static inline __m256 cellAVX2F(const double *x, double off, __m256i *h, __m256 *t)
+{
+    __m256d lo = _mm256_add_pd(_mm256_loadu_pd(x),   _mm256_set1_pd(off));
+    __m256d hi = _mm256_add_pd(_mm256_loadu_pd(x+4), _mm256_set1_pd(off));
+    __m256d ilo = _mm256_floor_pd(lo);
+    __m256d ihi = _mm256_floor_pd(hi);
+    *h = _mm256_and_si256(_mm256_set_m128i(
+        _mm256_cvttpd_epi32(ihi), _mm256_cvttpd_epi32(ilo)), _mm256_set1_epi32(0xff));
+    lo = _mm256_sub_pd(lo, ilo);
+    hi = _mm256_sub_pd(hi, ihi);
+    *t = _mm256_set_m128(_mm256_cvtpd_ps(fadeAVX2(hi)), _mm256_cvtpd_ps(fadeAVX2(lo)));
+    return _mm256_set_m128(_mm256_cvtpd_ps(hi), _mm256_cvtpd_ps(lo));
+}
+
+/* Returns the number of points processed (a multiple of 8). */
+ATTR(target("avx2"))
+static int samplePerlinAVX2F(const PerlinNoise *noise, float *out,
+        const double *x, const double *y, const double *z, int n)
+{
+    const int *idx = (const int*) noise->d;
+    const __m256i m8 = _mm256_set1_epi32(0xff);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m256i h1, h2, h3;
+        __m256 t1, t2, t3;
+        __m256 d1 = cellAVX2F(x+i, noise->a, &h1, &t1);
+        __m256 d2 = cellAVX2F(y+i, noise->b, &h2, &t2);
+        __m256 d3 = cellAVX2F(z+i, noise->c, &h3, &t3);
+
+        __m256i g1 = _mm256_i32gather_epi32(idx, h1, 1);
+        __m256i v1a = _mm256_and_si256(_mm256_add_epi32(g1, h2), m8);
+        __m256i v1b = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(g1, 8), h2), m8);
+        __m256i g2 = _mm256_i32gather_epi32(idx, v1a, 1);
+        __m256i g3 = _mm256_i32gather_epi32(idx, v1b, 1);
+        __m256i v2a = _mm256_and_si256(_mm256_add_epi32(g2, h3), m8);
+        __m256i v2b = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(g2, 8), h3), m8);
+        __m256i v3a = _mm256_and_si256(_mm256_add_epi32(g3, h3), m8);
+        __m256i v3b = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(g3, 8), h3), m8);
+        __m256i g4 = _mm256_i32gather_epi32(idx, v2a, 1);
+        __m256i g5 = _mm256_i32gather_epi32(idx, v2b, 1);
+        __m256i g6 = _mm256_i32gather_epi32(idx, v3a, 1);
+        __m256i g7 = _mm256_i32gather_epi32(idx, v3b, 1);
+
+        __m256 e1 = _mm256_sub_ps(d1, one);
+        __m256 e2 = _mm256_sub_ps(d2, one);
+        __m256 e3 = _mm256_sub_ps(d3, one);
+
+        __m256 l1 = gradAVX2F(g4,                       d1, d2, d3);
+        __m256 l5 = gradAVX2F(_mm256_srli_epi32(g4, 8), d1, d2, e3);
+        __m256 l2 = gradAVX2F(g6,                       e1, d2, d3);
+        __m256 l6 = gradAVX2F(_mm256_srli_epi32(g6, 8), e1, d2, e3);
+        __m256 l3 = gradAVX2F(g5,                       d1, e2, d3);
+        __m256 l7 = gradAVX2F(_mm256_srli_epi32(g5, 8), d1, e2, e3);
+        __m256 l4 = gradAVX2F(g7,                       e1, e2, d3);
+        __m256 l8 = gradAVX2F(_mm256_srli_epi32(g7, 8), e1, e2, e3);
+
+        l1 = lerpAVX2F(t1, l1, l2);
+        l3 = lerpAVX2F(t1, l3, l4);
+        l5 = lerpAVX2F(t1, l5, l6);
+        l7 = lerpAVX2F(t1, l7, l8);
+        l1 = lerpAVX2F(t2, l1, l3);
+        l5 = lerpAVX2F(t2, l5, l7);
+        _mm256_storeu_ps(out+i, lerpAVX2F(t3, l1, l5));
+    }
+    return i;
+}
+
+#endif // NOISE_SIMD_X86
+
+void samplePerlinBatchF(const PerlinNoise *noise, float *out,
+        const double *x, const double *y, const double *z, int n)
+{
+    int i = 0;
+#if NOISE_SIMD_X86
+    if (n >= 8 && __builtin_cpu_supports("avx2"))
+        i = samplePerlinAVX2F(noise, out, x, y, z, n);
+#endif
+    for (; i < n; i++)
+        out[i] = samplePerlinF(noise, x[i], y[i], z[i]);
+}
+
+void sampleOctaveBatchF(const OctaveNoise *noise, float *out,
+        const double *x, const double *y, const double *z, int n)
+{
+    double ax[NOISE_BATCH], ay[NOISE_BATCH], az[NOISE_BATCH];
+    float pv[NOISE_BATCH];
+    int b, i, j, m;
+
+    for (b = 0; b < n; b += m)
+    {
+        m = n - b < NOISE_BATCH ? n - b : NOISE_BATCH;
+        for (i = 0; i < m; i++)
+            out[b+i] = 0;
+        for (j = 0; j < noise->octcnt; j++)
+        {
+            const PerlinNoise *p = noise->octaves + j;
+            double lf = p->lacunarity;
+            float amp = (float) p->amplitude;
+            for (i = 0; i < m; i++)
+            {
+                ax[i] = maintainPrecision(x[b+i] * lf);
+                ay[i] = maintainPrecision(y[b+i] * lf);
+                az[i] = maintainPrecision(z[b+i] * lf);
+            }
+            samplePerlinBatchF(p, pv, ax, ay, az, m);
+            for (i = 0; i < m; i++)
+                out[b+i] += amp * pv[i];
+        }
+    }
+}
+
+void sampleDoublePerlinBatchF(const DoublePerlinNoise *noise, float *out,
+        const double *x, const double *y, const double *z, int n)
+{
+    const double f = 337.0 / 331.0;
+    double fx[NOISE_BATCH], fy[NOISE_BATCH], fz[NOISE_BATCH];
+    float vb[NOISE_BATCH];
+    float amp = (float) noise->amplitude;
+    int b, i, m;
+
+    for (b = 0; b < n; b += m)
+    {
+        m = n - b < NOISE_BATCH ? n - b : NOISE_BATCH;
+        for (i = 0; i < m; i++)
+        {
+            fx[i] = x[b+i] * f;
+            fy[i] = y[b+i] * f;
+            fz[i] = z[b+i] * f;
+        }
+        sampleOctaveBatchF(&noise->octA, out+b, x+b, y+b, z+b, m);
+        sampleOctaveBatchF(&noise->octB, vb, fx, fy, fz, m);
+        for (i = 0; i < m; i++)
+            out[b+i] = (out[b+i] + vb[i]) * amp;
+    }
+}
+
+/* Each octave term has the Perlin error plus the rounding of the amplitude
+ * and of the product, and each float addition adds at most one rounding of
+ * the partial sum, which is bounded by the total amplitude.
+ */
+double getOctaveErrorF(const OctaveNoise *noise)
+{
+    double asum = 0;
+    int i;
+    for (i = 0; i < noise->octcnt; i++)
+        asum += fabs(noise->octaves[i].amplitude);
+    return asum * (PERLIN_F_ERR + 2 * FLT_EPSILON * PERLIN_MAX) +
+        noise->octcnt * FLT_EPSILON * asum * PERLIN_MAX;
+}
+
+double getDoublePerlinErrorF(const DoublePerlinNoise *noise)
+{
+    double amp = fabs(noise->amplitude);
+    double asum = 0;
+    int i;
+    for (i = 0; i < noise->octA.octcnt; i++)
+        asum += fabs(noise->octA.octaves[i].amplitude);
+    for (i = 0; i < noise->octB.octcnt; i++)
+        asum += fabs(noise->octB.octaves[i].amplitude);
+    double err = getOctaveErrorF(&noise->octA) + getOctaveErrorF(&noise->octB);
+    // the final addition and scaling round twice more
+    return amp * (err + 2 * FLT_EPSILON * asum * PERLIN_MAX) +
+        FLT_EPSILON * amp * asum * PERLIN_MAX;
+}
+
+
+
+//==============================================================================
+// Batched initialisation
+//==============================================================================
+
+/* xPerlinInit() draws the three offsets and then the targets of its
+ * Fisher-Yates shuffle from the xoroshiro stream of the octave, and none of
+ * the draws depends on the permutation. So with AVX2, the draws of
+ * PERLIN_LANES streams are made together first in the lanes of two vectors,
+ * and the shuffles are applied afterwards, interleaved so that the swaps of
+ * the independent permutations can overlap. Without vectors this does not
+ * pay off, and the octaves are set up one by one.
+ */
+#if NOISE_SIMD_X86
+
+enum { PERLIN_LANES = 8 };
+
+static void xPerlinSetup(PerlinNoise *const *noise, int n,
+        uint64_t abc[3][PERLIN_LANES], uint8_t j[256][PERLIN_LANES])
+{
+    int i, l;
+    for (l = 0; l < n; l++)
+    {
+        PerlinNoise *p = noise[l];
+        // same as xNextDouble() * 256.0
+        p->a = (abc[0][l] >> (64-53)) * 1.1102230246251565E-16 * 256.0;
+        p->b = (abc[1][l] >> (64-53)) * 1.1102230246251565E-16 * 256.0;
+        p->c = (abc[2][l] >> (64-53)) * 1.1102230246251565E-16 * 256.0;
+        for (i = 0; i < 256; i++)
+            p->d[i] = i;
+    }
+    for (i = 0; i < 256; i++)
+    {
+        for (l = 0; l < n; l++)
+        {
+            uint8_t *idx = noise[l]->d;
+            uint8_t k = j[i][l];
+            uint8_t t = idx[i];
+            idx[i] = idx[k];
+            idx[k] = t;
+        }
+    }
+    for (l = 0; l < n; l++)
+    {
+        PerlinNoise *p = noise[l];
+        p->d[256] = p->d[0];
+        double i2 = floor(p->b);
+        double d2 = p->b - i2;
+        p->h2 = (int) i2;
+        p->d2 = d2;
+        p->t2 = d2*d2*d2 * (d2 * (d2*6.0-15.0) + 10.0);
+    }
+}
+
+ATTR(target("avx2"))
+static inline __m256i xNextLongAVX2(__m256i *lo, __m256i *hi)
+{   // xNextLong() on four streams, AVX2 has no 64-bit rotation
+    __m256i l = *lo, h = *hi;
+    __m256i s = _mm256_add_epi64(l, h);
+    __m256i n = _mm256_add_epi64(_mm256_or_si256(
+        _mm256_slli_epi64(s, 17), _mm256_srli_epi64(s, 47)), l);
+    h = _mm256_xor_si256(h, l);
+    l = _mm256_or_si256(_mm256_slli_epi64(l, 49), _mm256_srli_epi64(l, 15));
+    *lo = _mm256_xor_si256(_mm256_xor_si256(l, h), _mm256_slli_epi64(h, 21));
+    *hi = _mm256_or_si256(_mm256_slli_epi64(h, 28), _mm256_srli_epi64(h, 36));
+    return n;
+}
+
+ATTR(target("avx2"))
+static inline __m256i xNextIntAVX2(__m256i *lo, __m256i *hi, uint32_t bound)
+{   // xNextInt(xr, bound) on four streams, without the final shift
+    __m256i r = _mm256_mul_epu32(xNextLongAVX2(lo, hi), _mm256_set1_epi64x(bound));
+    __m256i low = _mm256_and_si256(r, _mm256_set1_epi64x(0xffffffff));
+    __m256i rej = _mm256_cmpgt_epi64(_mm256_set1_epi64x(bound), low);
+    if (!_mm256_testz_si256(rej, rej))
+    {   // very rarely a lane may need to redraw, do that one by one
+        uint64_t rv[4];
+        Xoroshiro x[4];
+        int l;
+        _mm256_storeu_si256((__m256i*) rv, r);
+        for (l = 0; l < 4; l++)
+        {
+            x[l].lo = _mm256_extract_epi64(*lo, 0);
+            x[l].hi = _mm256_extract_epi64(*hi, 0);
+            *lo = _mm256_permute4x64_epi64(*lo, 0x39);
+            *hi = _mm256_permute4x64_epi64(*hi, 0x39);
+            while ((uint32_t)rv[l] < (~bound + 1) % bound)
+                rv[l] = (xNextLong(&x[l]) & 0xffffffff) * bound;
+        }
+        *lo = _mm256_setr_epi64x(x[0].lo, x[1].lo, x[2].lo, x[3].lo);
+        *hi = _mm256_setr_epi64x(x[0].hi, x[1].hi, x[2].hi, x[3].hi);
+        r = _mm256_loadu_si256((const __m256i*) rv);
+    }
+    return r;
+}
+
+/* Draws for all PERLIN_LANES streams as two independent vectors. */
+ATTR(target("avx2"))
+static void xPerlinDrawAVX2(Xoroshiro *xr,
+        uint64_t abc[3][PERLIN_LANES], uint8_t j[256][PERLIN_LANES])
+{
+    __m256i lo0 = _mm256_setr_epi64x(xr[0].lo, xr[1].lo, xr[2].lo, xr[3].lo);
+    __m256i hi0 = _mm256_setr_epi64x(xr[0].hi, xr[1].hi, xr[2].hi, xr[3].hi);
+    __m256i lo1 = _mm256_setr_epi64x(xr[4].lo, xr[5].lo, xr[6].lo, xr[7].lo);
+    __m256i hi1 = _mm256_setr_epi64x(xr[4].hi, xr[5].hi, xr[6].hi, xr[7].hi);
+    const __m256i perm = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+    int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        _mm256_storeu_si256((__m256i*) abc[i], xNextLongAVX2(&lo0, &hi0));
+        _mm256_storeu_si256((__m256i*) (abc[i]+4), xNextLongAVX2(&lo1, &hi1));
+    }
+    for (i = 0; i < 256; i++)
+    {
+        __m256i r0 = _mm256_srli_epi64(xNextIntAVX2(&lo0, &hi0, 256 - i), 32);
+        __m256i r1 = _mm256_srli_epi64(xNextIntAVX2(&lo1, &hi1, 256 - i), 32);
+        __m128i v0 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(r0, perm));
+        __m128i v1 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(r1, perm));
+        __m128i v = _mm_packus_epi32(v0, v1);
+        v = _mm_add_epi16(v, _mm_set1_epi16(i));
+        _mm_storel_epi64((__m128i*) j[i], _mm_packus_epi16(v, v));
+    }
+}
+
+#endif // NOISE_SIMD_X86
+
+void xPerlinQueue(PerlinQueue *q, PerlinNoise *noise, const Xoroshiro *xr)
+{
+    if (q->n == PERLIN_QUEUE)
+        xPerlinFlush(q);
+    q->noise[q->n] = noise;
+    q->xr[q->n] = *xr;
+    q->n++;
+}
+
+void xPerlinFlush(PerlinQueue *q)
+{
+    int i;
+
+#if NOISE_SIMD_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        int m;
+        uint64_t abc[3][PERLIN_LANES];
+        uint8_t j[256][PERLIN_LANES];
+        for (i = 0; i < q->n; i += m)
+        {
+            m = q->n - i < PERLIN_LANES ? q->n - i : PERLIN_LANES;
+            // pad the unused lanes with copies of the first stream
+            Xoroshiro xr[PERLIN_LANES];
+            int l;
+            for (l = 0; l < PERLIN_LANES; l++)
+                xr[l] = q->xr[i + (l < m ? l : 0)];
+            xPerlinDrawAVX2(xr, abc, j);
+            xPerlinSetup(q->noise + i, m, abc, j);
+        }
+        q->n = 0;
+        return;
+    }
+#endif
+
+    for (i = 0; i < q->n; i++)
+    {
+        PerlinNoise *p = q->noise[i];
+        double amp = p->amplitude, lac = p->lacunarity;
+        xPerlinInit(p, &q->xr[i]);
+        p->amplitude = amp;
+        p->lacunarity = lac;
+    }
+    q->n = 0;
+}
@@ -28,6 +28,13 @@ STRUCT(DoublePerlinNoise)
     OctaveNoise octB;
 };
 
+// Lookup table for sampling a PerlinNoise in the y = 0 plane: for each h1 it
+// holds the four permutation bytes that are reached through the constant h2.
+STRUCT(PerlinPlane)
+{
+    uint32_t idx[256];
+};
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -63,7 +70,6 @@ int xOctaveInit(OctaveNoise *noise, Xoroshiro *xr, PerlinNoise *octaves,
 double sampleOctave(const OctaveNoise *noise, double x, double y, double z);
 double sampleOctaveAmp(const OctaveNoise *noise, double x, double y, double z,
         double yamp, double ymin, int ydefault);
-double sampleOctave2D(const OctaveNoise *noise, double x, double z);
 double sampleOctaveBeta17Biome(const OctaveNoise *noise, double x, double z);
 void sampleOctaveBeta17Terrain(const OctaveNoise *noise, double *v,
         double x, double z, int yLacFlag, double lacmin);
@@ -77,6 +83,108 @@ int xDoublePerlinInit(DoublePerlinNoise *noise, Xoroshiro *xr,
 double sampleDoublePerlin(const DoublePerlinNoise *noise,
         double x, double y, double z);
 
+/// Batched initialisation
+// The permutation of a xoroshiro seeded Perlin octave is shuffled from the
+// octave's own random stream, so the octaves of several noises, or seeds, can
+// be set up together. The Queue variants of the initialisers set everything
+// but the octave permutations and offsets, and only record the octaves in
+// the queue. xPerlinFlush() then sets them up, drawing from several streams
+// at once in SIMD lanes, with identical results. A full queue is flushed when
+// another octave is added. The queue has to start with n = 0 and has to be
+// flushed before the noise is sampled.
+enum { PERLIN_QUEUE = 64 };
+
+STRUCT(PerlinQueue)
+{
+    int n;
+    PerlinNoise *noise[PERLIN_QUEUE];
+    Xoroshiro xr[PERLIN_QUEUE];
+};
+
+void xPerlinQueue(PerlinQueue *q, PerlinNoise *noise, const Xoroshiro *xr);
+void xPerlinFlush(PerlinQueue *q);
+
+int xOctaveInitQueue(OctaveNoise *noise, Xoroshiro *xr, PerlinNoise *octaves,
+        const double *amplitudes, int omin, int len, int nmax, PerlinQueue *q);
+int xDoublePerlinInitQueue(DoublePerlinNoise *noise, Xoroshiro *xr,
+        PerlinNoise *octaves, const double *amplitudes, int omin, int len,
+        int nmax, PerlinQueue *q);
+
+/// Batch sampling
+// These evaluate the noise at the n points (x[i], y[i], z[i]) and store the
+// results in out[i]. They are bit-identical to sampling the points one by
+// one, but use SIMD kernels (AVX2/AVX-512) when the CPU supports them.
+void samplePerlinBatch(const PerlinNoise *noise, double *out,
+        const double *x, const double *y, const double *z, int n);
+void sampleOctaveBatch(const OctaveNoise *noise, double *out,
+        const double *x, const double *y, const double *z, int n);
+void sampleDoublePerlinBatch(const DoublePerlinNoise *noise, double *out,
+        const double *x, const double *y, const double *z, int n);
+
+/// Sampling at y = 0
+// Equivalent to the above with y = 0 and bit-identical to them. The optional
+// planes (NULL to compute the lookups on the fly) are built once per noise
+// and save two of the seven permutation lookups of each sample, which pays
+// off when many points are sampled. A DoublePerlinNoise needs one plane per
+// octave of octA followed by octB; the initialisation returns that count.
+void perlinPlaneInit(PerlinPlane *plane, const PerlinNoise *noise);
+int octavePlaneInit(PerlinPlane *planes, const OctaveNoise *noise);
+int doublePerlinPlaneInit(PerlinPlane *planes, const DoublePerlinNoise *noise);
+
+double samplePerlin2D(const PerlinNoise *noise, const PerlinPlane *plane,
+        double x, double z);
+double sampleOctave2D(const OctaveNoise *noise, const PerlinPlane *planes,
+        double x, double z);
+double sampleDoublePerlin2D(const DoublePerlinNoise *noise,
+        const PerlinPlane *planes, double x, double z);
+
+void samplePerlinBatch2D(const PerlinNoise *noise, const PerlinPlane *plane,
+        double *out, const double *x, const double *z, int n);
+void sampleOctaveBatch2D(const OctaveNoise *noise, const PerlinPlane *planes,
+        double *out, const double *x, const double *z, int n);
+void sampleDoublePerlinBatch2D(const DoublePerlinNoise *noise,
+        const PerlinPlane *planes, double *out, const double *x, const double *z,
+        int n);
+
+/// Bounded sampling
+// Decides how a double Perlin noise sample compares to the range [lo, hi].
+// The octaves with the larger amplitudes are evaluated first and sampling
+// stops as soon as the remaining ones cannot change the outcome: -1 if the
+// sample is below lo, +1 if it is above hi, and 0 otherwise. The decision is
+// exact, i.e. the same as for sampleDoublePerlin(). Only when all octaves
+// were needed, the sample itself is written to v (nullable). The optional
+// stats accumulate the octaves that were evaluated and skipped.
+STRUCT(NoiseBoundStats)
+{
+    uint64_t samples;
+    uint64_t octaves;
+    uint64_t skipped;
+};
+
+int sampleDoublePerlinBounded(const DoublePerlinNoise *noise,
+        NoiseBoundStats *stats, double x, double y, double z,
+        double lo, double hi, double *v);
+
+/// Approximate sampling
+// Single precision variants of the batch samplers for prefilters that only
+// need to reject points away from a decision boundary. The coordinates are
+// reduced in double precision, the rest runs in float at twice the SIMD
+// width. The absolute error of a Perlin sample is at most PERLIN_F_ERR, and
+// the error functions give the bound for a whole noise: a point whose
+// approximate value is further than that from a threshold is on the same
+// side of it as the exact sample, otherwise it has to be resampled exactly.
+#define PERLIN_F_ERR 3e-6
+
+void samplePerlinBatchF(const PerlinNoise *noise, float *out,
+        const double *x, const double *y, const double *z, int n);
+void sampleOctaveBatchF(const OctaveNoise *noise, float *out,
+        const double *x, const double *y, const double *z, int n);
+void sampleDoublePerlinBatchF(const DoublePerlinNoise *noise, float *out,
+        const double *x, const double *y, const double *z, int n);
+
+double getOctaveErrorF(const OctaveNoise *noise);
+double getDoublePerlinErrorF(const DoublePerlinNoise *noise);
+
 
 #ifdef __cplusplus
 }
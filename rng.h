@@ -49,6 +49,7 @@ static inline uint32_t BSWAP32(uint32_t x) {
     return x;
 }
 #if _MSC_VER
+#include <intrin.h>
 #define UNREACHABLE()           __assume(0)
 #else
 #define UNREACHABLE()           exit(1) // [[noreturn]]
@@ -79,6 +80,51 @@ int32_t floordiv(int32_t a, int32_t b)
     return q - ((a ^ b) < 0 && !!r);
 }
 
+/// once-guard for data that is built lazily and then only read
+// The state starts at zero. The first caller gets 1 and has to build the data
+// and then call onceDone(). All other callers get 0 when the data is ready,
+// concurrent ones wait for the builder.
+static inline int onceBegin(int *state)
+{
+#if __GNUC__
+    int expected = 0;
+    if (__atomic_load_n(state, __ATOMIC_ACQUIRE) == 2)
+        return 0;
+    if (__atomic_compare_exchange_n(state, &expected, 1, 0,
+            __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+        return 1;
+    while (__atomic_load_n(state, __ATOMIC_ACQUIRE) != 2)
+        ;
+    return 0;
+#elif _MSC_VER
+    // the interlocked operations are full barriers, a compare-exchange with
+    // an unchanged value serves as the acquiring load
+    volatile long *p = (volatile long*) state;
+    if (_InterlockedCompareExchange(p, 0, 0) == 2)
+        return 0;
+    if (_InterlockedCompareExchange(p, 1, 0) == 0)
+        return 1;
+    while (_InterlockedCompareExchange(p, 0, 0) != 2)
+        ;
+    return 0;
+#else
+    // without atomics, the first use has to happen before any others are
+    // made on different threads
+    return *state == 0;
+#endif
+}
+
+static inline void onceDone(int *state)
+{
+#if __GNUC__
+    __atomic_store_n(state, 2, __ATOMIC_RELEASE);
+#elif _MSC_VER
+    _InterlockedExchange((volatile long*) state, 2);
+#else
+    *state = 2;
+#endif
+}
+
 ///=============================================================================
 ///                    C implementation of Java Random
 ///=============================================================================
@@ -1,8 +1,10 @@
 #include "api.h"
 #include "engine.h"
+#include "tiles.h"
 
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <stdint.h>
@@ -13,6 +15,7 @@
 
 #include "../biomes.h"
 #include "../finders.h"
+#include "../generator.h"
 
 /* ══════════════════════════════════════════════════════════════════════════
  * Rate limiter
@@ -136,6 +139,31 @@ static int json_read_int(const char *json, const char *key, int *out)
     return 1;
 }
 
+static int json_read_bool(const char *json, const char *key, int *out)
+{
+    const char *p = json_find_value(json, key);
+    if (!p) return 0;
+    if (strncmp(p, "true", 4) == 0)  { *out = 1; return 1; }
+    if (strncmp(p, "false", 5) == 0) { *out = 0; return 1; }
+    return 0;
+}
+
+/* Copy the object value of key (including braces) into out.
+ * Returns 0 if the key is absent or its value is not a flat object. */
+static int json_read_object(const char *json, const char *key,
+                             char *out, size_t maxlen)
+{
+    const char *p = json_find_value(json, key);
+    if (!p || *p != '{') return 0;
+    const char *end = strchr(p, '}');
+    if (!end) return 0;
+    size_t len = (size_t)(end - p) + 1;
+    if (len >= maxlen) len = maxlen - 1;
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return 1;
+}
+
 /* ══════════════════════════════════════════════════════════════════════════
  * SHA-1  (RFC 3174) — used only for the WebSocket handshake
  * ══════════════════════════════════════════════════════════════════════════ */
@@ -344,8 +372,36 @@ static int parse_request(const char *body, SearchRequest *req,
     if (req->max_results > MAX_RESULTS)
         req->max_results = MAX_RESULTS;
 
+    char spawn_obj[256];
+    if (json_read_object(body, "spawn", spawn_obj, sizeof(spawn_obj))) {
+        int64_t max_dist = 0;
+        json_read_int64(spawn_obj, "max_distance", &max_dist);
+        if (max_dist <= 0) {
+            *errmsg = "spawn max_distance must be positive";
+            return 0;
+        }
+        if (max_dist > INT_MAX) {
+            *errmsg = "spawn max_distance is too large";
+            return 0;
+        }
+        if (req->mc_version <= MC_B1_7) {
+            *errmsg = "spawn constraint not available in requested version";
+            return 0;
+        }
+        req->spawn.enabled      = 1;
+        req->spawn.max_distance = (int)max_dist;
+        req->spawn.use_estimate = 1;
+        json_read_int(spawn_obj,  "x",        &req->spawn.x);
+        json_read_int(spawn_obj,  "z",        &req->spawn.z);
+        json_read_bool(spawn_obj, "estimate", &req->spawn.use_estimate);
+    }
+
     const char *arr = strstr(body, "\"structures\"");
-    if (!arr) { *errmsg = "missing structures"; return 0; }
+    if (!arr) {
+        if (req->spawn.enabled) return 1;
+        *errmsg = "missing structures";
+        return 0;
+    }
     arr = strchr(arr, '[');
     if (!arr) { *errmsg = "structures is not an array"; return 0; }
     arr++;
@@ -375,6 +431,7 @@ static int parse_request(const char *body, SearchRequest *req,
         int stype = parse_structure_type(type_name);
         if (stype < 0) { *errmsg = "unknown structure type"; return 0; }
         if (max_dist <= 0) { *errmsg = "max_distance must be positive"; return 0; }
+        if (max_dist > INT_MAX) { *errmsg = "max_distance is too large"; return 0; }
 
         StructureConfig sconf;
         if (!getStructureConfig(stype, req->mc_version, &sconf)) {
@@ -395,7 +452,10 @@ static int parse_request(const char *body, SearchRequest *req,
         arr = end + 1;
     }
 
-    if (req->num_structures == 0) { *errmsg = "structures array is empty"; return 0; }
+    if (req->num_structures == 0 && !req->spawn.enabled) {
+        *errmsg = "structures array is empty";
+        return 0;
+    }
     return 1;
 }
 
@@ -566,6 +626,133 @@ static enum MHD_Result send_response(struct MHD_Connection *conn,
     return ret;
 }
 
+/* Queue a binary response.  If owned, takes ownership of data (allocated by
+ * malloc); otherwise data must outlive the daemon and is sent without a copy. */
+static enum MHD_Result send_binary(struct MHD_Connection *conn,
+                                    const unsigned char   *data,
+                                    size_t                 len,
+                                    const char            *mime,
+                                    int                    owned)
+{
+    struct MHD_Response *resp =
+        MHD_create_response_from_buffer(len, (void *)data,
+            owned ? MHD_RESPMEM_MUST_FREE : MHD_RESPMEM_PERSISTENT);
+    if (!resp) {
+        if (owned)
+            free((void *)data);
+        return MHD_NO;
+    }
+    MHD_add_response_header(resp, "Content-Type", mime);
+    /* tiles are a pure function of the URL */
+    MHD_add_response_header(resp, "Cache-Control", "public, max-age=86400");
+    enum MHD_Result ret = MHD_queue_response(conn, MHD_HTTP_OK, resp);
+    MHD_destroy_response(resp);
+    return ret;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════
+ * GET /tile/{seed}/{mc}/{dim}/{zoom}/{x}/{y}
+ * ══════════════════════════════════════════════════════════════════════════ */
+
+static int parse_dimension(const char *str, int *dim)
+{
+    if (strcmp(str, "overworld") == 0 || strcmp(str, "0") == 0)
+        *dim = DIM_OVERWORLD;
+    else if (strcmp(str, "nether") == 0 || strcmp(str, "-1") == 0)
+        *dim = DIM_NETHER;
+    else if (strcmp(str, "end") == 0 || strcmp(str, "1") == 0)
+        *dim = DIM_END;
+    else
+        return 0;
+    return 1;
+}
+
+static int parse_int_segment(const char *str, int64_t *out)
+{
+    char *end;
+    *out = (int64_t)strtoll(str, &end, 10);
+    return end != str && *end == '\0';
+}
+
+/* Split the path after "/tile/" into its six segments and fill *key. */
+static int parse_tile_path(const char *path, TileKey *key, const char **errmsg)
+{
+    char buf[256];
+    char *seg[6];
+    int   n = 0;
+
+    if (strlen(path) >= sizeof(buf)) { *errmsg = "path too long"; return 0; }
+    strcpy(buf, path);
+
+    char *p = buf;
+    while (n < 6) {
+        seg[n++] = p;
+        char *slash = strchr(p, '/');
+        if (!slash) break;
+        *slash = '\0';
+        p = slash + 1;
+    }
+    if (n != 6 || strchr(p, '/')) {
+        *errmsg = "expected /tile/{seed}/{mc}/{dim}/{zoom}/{x}/{y}";
+        return 0;
+    }
+
+    int64_t seed, zoom, x, y;
+    if (!parse_int_segment(seg[0], &seed)) { *errmsg = "invalid seed"; return 0; }
+    key->mc = parse_mc_version(seg[1]);
+    if (key->mc == MC_UNDEF) { *errmsg = "unknown version string"; return 0; }
+    if (!parse_dimension(seg[2], &key->dim)) { *errmsg = "unknown dimension"; return 0; }
+    if (!parse_int_segment(seg[3], &zoom) || zoom < 0 || zoom > TILE_MAX_ZOOM) {
+        *errmsg = "invalid zoom";
+        return 0;
+    }
+    if (!parse_int_segment(seg[4], &x) || !parse_int_segment(seg[5], &y) ||
+        x < INT32_MIN || x > INT32_MAX || y < INT32_MIN || y > INT32_MAX) {
+        *errmsg = "invalid tile coordinates";
+        return 0;
+    }
+    key->seed = (uint64_t)seed;
+    key->zoom = (int)zoom;
+    key->x    = (int)x;
+    key->y    = (int)y;
+    return 1;
+}
+
+static enum MHD_Result handle_tile(struct MHD_Connection *conn, const char *path)
+{
+    TileKey     key;
+    const char *errmsg = NULL;
+    memset(&key, 0, sizeof(key));
+
+    if (!parse_tile_path(path, &key, &errmsg)) {
+        char errbuf[256];
+        snprintf(errbuf, sizeof(errbuf), "{\"error\":\"%s\"}", errmsg);
+        return send_response(conn, MHD_HTTP_BAD_REQUEST, errbuf);
+    }
+    const char *large = MHD_lookup_connection_value(
+        conn, MHD_GET_ARGUMENT_KIND, "large");
+    if (large && strcmp(large, "0") != 0 && strcmp(large, "false") != 0)
+        key.flags |= LARGE_BIOMES;
+
+    const unsigned char *data  = NULL;
+    size_t               len   = 0;
+    const char          *mime  = NULL;
+    int                  owned = 0;
+    switch (tile_render(&key, &data, &len, &mime, &owned)) {
+    case TILE_OK:
+        return send_binary(conn, data, len, mime, owned);
+    case TILE_ERR_ARGS:
+        return send_response(conn, MHD_HTTP_BAD_REQUEST,
+                             "{\"error\":\"tile out of range\"}");
+    case TILE_ERR_BUSY:
+        return send_response(conn, MHD_HTTP_SERVICE_UNAVAILABLE,
+                             "{\"error\":\"all tile generators busy\"}");
+    default:
+        return send_response(conn, MHD_HTTP_INTERNAL_SERVER_ERROR,
+                             "{\"error\":\"out of memory\"}");
+    }
+}
+
 /* ══════════════════════════════════════════════════════════════════════════
  * Per-connection POST body accumulation state
  * ══════════════════════════════════════════════════════════════════════════ */
@@ -635,6 +822,14 @@ enum MHD_Result handle_request(void *cls,
             return r;
         }
 
+        /* ── GET /tile/{seed}/{mc}/{dim}/{zoom}/{x}/{y} ───────────────────── */
+        if (strncmp(url, "/tile/", 6) == 0) {
+            if (strcmp(method, "GET") != 0)
+                return send_response(connection, MHD_HTTP_METHOD_NOT_ALLOWED,
+                                     "{\"error\":\"use GET\"}");
+            return handle_tile(connection, url + 6);
+        }
+
         /* ── GET /search/stream  (WebSocket upgrade) ─────────────────────── */
         if (strcmp(url, "/search/stream") == 0) {
             if (strcmp(method, "GET") != 0)
@@ -0,0 +1,200 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "engine.h"
+#include "../finders.h"
+
+/*
+ * Engine throughput benchmark.
+ *
+ * For every (structure, version) pair the same fixed seed range is searched
+ * once per thread count, and the seeds per second and scaling efficiency
+ * relative to one thread are reported.  An extra single-threaded run with
+ * per-stage profiling gives the breakdown of where the time goes.  The
+ * results are written to stdout as JSON.
+ */
+
+#define BENCH_MAX_ITEMS 32
+
+static const char *g_default_structures[] = {
+    "village", "outpost", "monument", "mansion", "swamp_hut", "ancient_city",
+    "trial_chambers", NULL
+};
+
+static const char *g_default_versions[] = {
+    "1.12", "1.16.5", "1.18", "1.20", "1.21", NULL
+};
+
+static const char *g_stage_names[SEARCH_STAGES] = {
+    "apply_seed", "structure_pos", "viability", "biome_filter", "spawn"
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void count_seed(int64_t seed, void *userdata)
+{
+    (void)seed;
+    (*(int64_t *)userdata)++;
+}
+
+/* Search the whole range (results are counted, never capped) and return the
+ * elapsed wall time in seconds. */
+static double run_search(SearchRequest *req, int64_t *scanned, int64_t *found)
+{
+    *found = 0;
+    double t = -now();
+    search_seeds_stream(req, count_seed, found, scanned);
+    return t + now();
+}
+
+/* Split a comma-separated list in place. */
+static int split_list(char *str, const char **items, int max)
+{
+    int n = 0;
+    for (char *tok = strtok(str, ","); tok && n < max; tok = strtok(NULL, ","))
+        items[n++] = tok;
+    return n;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -s <list>     structures, comma separated (default: a common set)\n"
+        "  -v <list>     versions, comma separated (default: 1.12 ... 1.21)\n"
+        "  -t <threads>  highest thread count, runs 1, 2, 4, ... (default: CPUs)\n"
+        "  -n <seeds>    seeds searched per run (default 20000)\n"
+        "  -b <seed>     first seed of the range (default 0)\n"
+        "  -d <blocks>   max structure distance (default 1024)\n",
+        prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *structures[BENCH_MAX_ITEMS];
+    const char *versions[BENCH_MAX_ITEMS];
+    int nstructs = 0, nversions = 0;
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int64_t nseeds = 20000, first = 0;
+    int max_distance = 1024;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:v:t:n:b:d:h")) != -1) {
+        switch (opt) {
+        case 's': nstructs  = split_list(optarg, structures, BENCH_MAX_ITEMS); break;
+        case 'v': nversions = split_list(optarg, versions, BENCH_MAX_ITEMS); break;
+        case 't': max_threads  = atoi(optarg); break;
+        case 'n': nseeds       = strtoll(optarg, NULL, 10); break;
+        case 'b': first        = strtoll(optarg, NULL, 10); break;
+        case 'd': max_distance = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (!nstructs)
+        for (; g_default_structures[nstructs]; nstructs++)
+            structures[nstructs] = g_default_structures[nstructs];
+    if (!nversions)
+        for (; g_default_versions[nversions]; nversions++)
+            versions[nversions] = g_default_versions[nversions];
+    if (max_threads < 1)
+        max_threads = 1;
+    if (max_threads > MAX_THREADS)
+        max_threads = MAX_THREADS;
+    if (nseeds < 1 || max_distance < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int thread_counts[8], ncounts = 0;
+    for (int t = 1; t < max_threads; t *= 2)
+        thread_counts[ncounts++] = t;
+    thread_counts[ncounts++] = max_threads;
+
+    printf("{\n  \"seeds\": %lld,\n  \"first_seed\": %lld,\n"
+           "  \"max_distance\": %d,\n  \"cpus\": %ld,\n  \"results\": [",
+           (long long)nseeds, (long long)first, max_distance,
+           sysconf(_SC_NPROCESSORS_ONLN));
+
+    int nresults = 0;
+    for (int si = 0; si < nstructs; si++) {
+        int stype = parse_structure_type(structures[si]);
+        if (stype < 0) {
+            fprintf(stderr, "Unknown structure: %s\n", structures[si]);
+            return 1;
+        }
+        for (int vi = 0; vi < nversions; vi++) {
+            int mc = parse_mc_version(versions[vi]);
+            if (mc == MC_UNDEF) {
+                fprintf(stderr, "Unknown version: %s\n", versions[vi]);
+                return 1;
+            }
+            StructureConfig sconf;
+            if (!getStructureConfig(stype, mc, &sconf))
+                continue;   /* structure does not exist in this version */
+
+            SearchRequest req;
+            memset(&req, 0, sizeof(req));
+            req.mc_version     = mc;
+            req.seed_start     = first;
+            req.seed_end       = first + nseeds - 1;
+            req.max_results    = INT32_MAX;
+            req.num_structures = 1;
+            req.structures[0].type         = stype;
+            req.structures[0].max_distance = max_distance;
+            req.structures[0].biome        = -1;
+
+            fprintf(stderr, "%s %s ...\n", structures[si], versions[vi]);
+            printf("%s\n    {\n      \"structure\": \"%s\",\n"
+                   "      \"version\": \"%s\",\n      \"runs\": [",
+                   nresults++ ? "," : "", structures[si], versions[vi]);
+
+            double base = 0;
+            int64_t scanned = 0, found = 0;
+            for (int ti = 0; ti < ncounts; ti++) {
+                req.num_threads = thread_counts[ti];
+                double secs = run_search(&req, &scanned, &found);
+                double rate = secs > 0 ? scanned / secs : 0;
+                if (ti == 0)
+                    base = rate;
+                double eff = base > 0 ? rate / (base * thread_counts[ti]) : 0;
+                printf("%s\n        { \"threads\": %d, \"scanned\": %lld, "
+                       "\"found\": %lld, \"seconds\": %.6f, "
+                       "\"seeds_per_sec\": %.1f, \"efficiency\": %.3f }",
+                       ti ? "," : "", thread_counts[ti], (long long)scanned,
+                       (long long)found, secs, rate, eff);
+            }
+
+            /* profiled single-threaded pass for the stage breakdown */
+            SearchStats stats;
+            memset(&stats, 0, sizeof(stats));
+            req.num_threads = 1;
+            req.stats = &stats;
+            double secs = run_search(&req, &scanned, &found);
+
+            printf("\n      ],\n      \"profiled_seconds\": %.6f,\n"
+                   "      \"stages\": {", secs);
+            for (int s = 0; s < SEARCH_STAGES; s++) {
+                printf("%s\n        \"%s\": { \"calls\": %lld, "
+                       "\"passed\": %lld, \"seconds\": %.6f }",
+                       s ? "," : "", g_stage_names[s],
+                       (long long)stats.calls[s], (long long)stats.passed[s],
+                       stats.nanos[s] * 1e-9);
+            }
+            printf("\n      }\n    }");
+            fflush(stdout);
+        }
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -2,6 +2,7 @@
 
 #include <string.h>
 #include <pthread.h>
+#include <time.h>
 
 #include "../finders.h"
 #include "../generator.h"
@@ -207,6 +208,45 @@ const char * const *get_biome_names(void)
 /* How often (in seeds scanned) each thread re-checks the shared done flag */
 #define RESULT_CHECK_INTERVAL 0x1000  /* every 4096 seeds */
 
+/* ── per-stage profiling ─────────────────────────────────────────────────── */
+
+/* Stage counters are kept per thread and merged once a worker finishes.
+ * Timing is only sampled when the request asks for statistics. */
+typedef struct {
+    SearchStats s;
+    int         timed;
+} StageProf;
+
+static int64_t now_nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline int64_t stage_begin(const StageProf *p)
+{
+    return p->timed ? now_nanos() : 0;
+}
+
+static inline int stage_end(StageProf *p, int stage, int64_t t0, int pass)
+{
+    p->s.calls[stage]++;
+    p->s.passed[stage] += pass != 0;
+    if (p->timed)
+        p->s.nanos[stage] += now_nanos() - t0;
+    return pass;
+}
+
+static void merge_stats(SearchStats *dst, const SearchStats *src)
+{
+    for (int i = 0; i < SEARCH_STAGES; i++) {
+        dst->calls[i]  += src->calls[i];
+        dst->passed[i] += src->passed[i];
+        dst->nanos[i]  += src->nanos[i];
+    }
+}
+
 /* ── biome check helper ──────────────────────────────────────────────────── */
 
 /* Returns 1 if the structure position satisfies the optional biome filter,
@@ -225,6 +265,121 @@ static int check_biome_filter(Generator *g, const StructureQuery *sq,
     return biome_at == sq->biome;
 }
 
+/* ── spawn check helper ──────────────────────────────────────────────────── */
+
+int spawn_estimate_error(int mc_version)
+{
+    /* getSpawn() starts from the chunk of the estimate and scans a spiral of
+     * chunks around it, testing 4x4 positions per chunk (or falls back to the
+     * chunk centre).  The per-axis offset is therefore bounded by the spiral
+     * radius plus one chunk, and the distance by sqrt(2) times that. */
+    if (mc_version <= MC_B1_7)
+        return 0;               /* no refinement, estimate is exact */
+    if (mc_version <= MC_1_12)
+        return -1;              /* random walk, effectively unbounded */
+    if (mc_version <= MC_1_17)
+        return 380;             /* 16 chunk spiral: |d| <= 268 per axis */
+    return 135;                 /* 5 chunk spiral:  |d| <= 95 per axis  */
+}
+
+/* Returns 1 if the world spawn of the seed applied to g lies within the
+ * requested distance.  The (expensive) exact getSpawn() is only evaluated
+ * when the bounded estimate cannot decide the outcome on its own. */
+static int check_spawn(const Generator *g, const SpawnQuery *sq)
+{
+    int64_t md = sq->max_distance;
+    int err = sq->use_estimate ? spawn_estimate_error(g->mc) : -1;
+
+    if (err >= 0) {
+        Pos est = estimateSpawn(g, NULL);
+        int64_t dx = est.x - sq->x, dz = est.z - sq->z;
+        int64_t d2 = dx*dx + dz*dz;
+        int64_t hi = md + err;
+        int64_t lo = md - err;
+        if (d2 > hi * hi)
+            return 0;
+        if (lo >= 0 && d2 <= lo * lo)
+            return 1;
+    }
+
+    Pos spawn = getSpawn(g);
+    int64_t dx = spawn.x - sq->x, dz = spawn.z - sq->z;
+    return dx*dx + dz*dz <= md * md;
+}
+
+/* ── per-seed evaluation ─────────────────────────────────────────────────── */
+
+/* Applies the seed to g and returns 1 if it satisfies every constraint of
+ * the request.  Structure queries are checked first as they are cheapest;
+ * the spawn constraint only runs for seeds that pass all of them. */
+static int check_seed(Generator *g, const SearchRequest *req, int64_t seed,
+                      StageProf *prof)
+{
+    int64_t t0 = stage_begin(prof);
+    applySeed(g, DIM_OVERWORLD, (uint64_t)seed);
+    stage_end(prof, STAGE_APPLY_SEED, t0, 1);
+
+    for (int s = 0; s < req->num_structures; s++) {
+        const StructureQuery *sq = &req->structures[s];
+
+        StructureConfig sconf;
+        if (!getStructureConfig(sq->type, req->mc_version, &sconf))
+            return 0;
+
+        /* How many regions to scan in each direction */
+        int region_blocks = (int)sconf.regionSize * 16;
+        int max_reg = (sq->max_distance / region_blocks) + 2;
+
+        int found = 0;
+        for (int rx = -max_reg; rx <= max_reg && !found; rx++) {
+            for (int rz = -max_reg; rz <= max_reg && !found; rz++) {
+                Pos pos;
+                t0 = stage_begin(prof);
+                int ok = getStructurePos(sq->type, req->mc_version,
+                                         (uint64_t)seed, rx, rz, &pos);
+
+                /* Distance check (squared to avoid sqrt) */
+                if (ok) {
+                    int64_t dx = pos.x, dz = pos.z;
+                    int64_t d2 = dx*dx + dz*dz;
+                    int64_t md = sq->max_distance;
+                    ok = d2 <= md * md;
+                }
+                if (!stage_end(prof, STAGE_STRUCT_POS, t0, ok))
+                    continue;
+
+                /* Biome viability check */
+                t0 = stage_begin(prof);
+                ok = isViableStructurePos(sq->type, g, pos.x, pos.z, 0);
+                if (!stage_end(prof, STAGE_VIABILITY, t0, ok))
+                    continue;
+
+                /* Optional biome filter */
+                if (sq->biome >= 0) {
+                    t0 = stage_begin(prof);
+                    ok = check_biome_filter(g, sq, req->mc_version, seed, pos);
+                    if (!stage_end(prof, STAGE_BIOME_FILTER, t0, ok))
+                        continue;
+                }
+
+                found = 1;
+            }
+        }
+
+        if (!found)
+            return 0;
+    }
+
+    if (req->spawn.enabled) {
+        t0 = stage_begin(prof);
+        int ok = check_spawn(g, &req->spawn);
+        if (!stage_end(prof, STAGE_SPAWN, t0, ok))
+            return 0;
+    }
+
+    return 1;
+}
+
 /* ── per-thread work ─────────────────────────────────────────────────────── */
 
 typedef struct {
@@ -244,6 +399,10 @@ static void *thread_worker(void *arg)
     Generator g;
     setupGenerator(&g, req->mc_version, 0);
 
+    StageProf prof;
+    memset(&prof, 0, sizeof(prof));
+    prof.timed = req->stats != NULL;
+
     int64_t local_scanned = 0;
 
     for (int64_t seed = targ->seed_start; seed <= targ->seed_end; seed++) {
@@ -259,55 +418,7 @@ static void *thread_worker(void *arg)
 
         local_scanned++;
 
-        applySeed(&g, DIM_OVERWORLD, (uint64_t)seed);
-
-        int valid = 1;
-
-        for (int s = 0; s < req->num_structures && valid; s++) {
-            const StructureQuery *sq = &req->structures[s];
-
-            StructureConfig sconf;
-            if (!getStructureConfig(sq->type, req->mc_version, &sconf)) {
-                valid = 0;
-                break;
-            }
-
-            /* How many regions to scan in each direction */
-            int region_blocks = (int)sconf.regionSize * 16;
-            int max_reg = (sq->max_distance / region_blocks) + 2;
-
-            int found = 0;
-            for (int rx = -max_reg; rx <= max_reg && !found; rx++) {
-                for (int rz = -max_reg; rz <= max_reg && !found; rz++) {
-                    Pos pos;
-                    if (!getStructurePos(sq->type, req->mc_version,
-                                        (uint64_t)seed, rx, rz, &pos))
-                        continue;
-
-                    /* Distance check (squared to avoid sqrt) */
-                    int64_t dx = pos.x, dz = pos.z;
-                    int64_t d2 = dx*dx + dz*dz;
-                    int64_t md = sq->max_distance;
-                    if (d2 > md * md)
-                        continue;
-
-                    /* Biome viability check */
-                    if (!isViableStructurePos(sq->type, &g,
-                                             pos.x, pos.z, 0))
-                        continue;
-
-                    /* Optional biome filter */
-                    if (!check_biome_filter(&g, sq, req->mc_version,
-                                           seed, pos))
-                        continue;
-
-                    found = 1;
-                }
-            }
-
-            if (!found)
-                valid = 0;
-        }
+        int valid = check_seed(&g, req, seed, &prof);
 
         if (valid) {
             pthread_mutex_lock(targ->mutex);
@@ -323,6 +434,8 @@ static void *thread_worker(void *arg)
 
     pthread_mutex_lock(targ->mutex);
     targ->result->scanned += local_scanned;
+    if (req->stats)
+        merge_stats(req->stats, &prof.s);
     pthread_mutex_unlock(targ->mutex);
 
     return NULL;
@@ -349,6 +462,10 @@ static void *stream_thread_worker(void *arg)
     Generator g;
     setupGenerator(&g, req->mc_version, 0);
 
+    StageProf prof;
+    memset(&prof, 0, sizeof(prof));
+    prof.timed = req->stats != NULL;
+
     int64_t local_scanned = 0;
 
     for (int64_t seed = targ->seed_start; seed <= targ->seed_end; seed++) {
@@ -363,50 +480,7 @@ static void *stream_thread_worker(void *arg)
 
         local_scanned++;
 
-        applySeed(&g, DIM_OVERWORLD, (uint64_t)seed);
-
-        int valid = 1;
-
-        for (int s = 0; s < req->num_structures && valid; s++) {
-            const StructureQuery *sq = &req->structures[s];
-
-            StructureConfig sconf;
-            if (!getStructureConfig(sq->type, req->mc_version, &sconf)) {
-                valid = 0;
-                break;
-            }
-
-            int region_blocks = (int)sconf.regionSize * 16;
-            int max_reg = (sq->max_distance / region_blocks) + 2;
-
-            int found = 0;
-            for (int rx = -max_reg; rx <= max_reg && !found; rx++) {
-                for (int rz = -max_reg; rz <= max_reg && !found; rz++) {
-                    Pos pos;
-                    if (!getStructurePos(sq->type, req->mc_version,
-                                        (uint64_t)seed, rx, rz, &pos))
-                        continue;
-
-                    int64_t dx = pos.x, dz = pos.z;
-                    int64_t md = sq->max_distance;
-                    if (dx*dx + dz*dz > md * md)
-                        continue;
-
-                    if (!isViableStructurePos(sq->type, &g, pos.x, pos.z, 0))
-                        continue;
-
-                    /* Optional biome filter */
-                    if (!check_biome_filter(&g, sq, req->mc_version,
-                                           seed, pos))
-                        continue;
-
-                    found = 1;
-                }
-            }
-
-            if (!found)
-                valid = 0;
-        }
+        int valid = check_seed(&g, req, seed, &prof);
 
         if (valid) {
             pthread_mutex_lock(targ->mutex);
@@ -426,6 +500,8 @@ static void *stream_thread_worker(void *arg)
 
     pthread_mutex_lock(targ->mutex);
     *targ->scanned_total += local_scanned;
+    if (req->stats)
+        merge_stats(req->stats, &prof.s);
     pthread_mutex_unlock(targ->mutex);
 
     return NULL;
@@ -441,6 +517,8 @@ void search_seeds(const SearchRequest *req, SearchResult *result)
 
     /* Clamp thread count */
     int nthreads = MAX_THREADS;
+    if (req->num_threads > 0 && req->num_threads < nthreads)
+        nthreads = req->num_threads;
     if (total < nthreads)
         nthreads = (int)total;
 
@@ -478,6 +556,8 @@ void search_seeds_stream(const SearchRequest *req,
     }
 
     int nthreads = MAX_THREADS;
+    if (req->num_threads > 0 && req->num_threads < nthreads)
+        nthreads = req->num_threads;
     if (total < nthreads)
         nthreads = (int)total;
 
@@ -13,6 +13,29 @@ typedef struct {
     int  biome;         /* required BiomeID at structure pos, or -1 for any */
 } StructureQuery;
 
+typedef struct {
+    int  enabled;       /* non-zero when the world spawn is constrained      */
+    int  x, z;          /* block position the distance is measured from      */
+    int  max_distance;  /* max block distance of the world spawn from (x,z)  */
+    int  use_estimate;  /* reject early on the bounded estimateSpawn() tier  */
+} SpawnQuery;
+
+/* Stages of the per-seed evaluation, in the order they run. */
+typedef enum {
+    STAGE_APPLY_SEED,   /* applySeed() for the overworld                    */
+    STAGE_STRUCT_POS,   /* getStructurePos() and the distance test          */
+    STAGE_VIABILITY,    /* isViableStructurePos()                           */
+    STAGE_BIOME_FILTER, /* optional biome at the structure position         */
+    STAGE_SPAWN,        /* optional world spawn constraint                  */
+    SEARCH_STAGES
+} SearchStage;
+
+typedef struct {
+    int64_t calls[SEARCH_STAGES];   /* times each stage was evaluated       */
+    int64_t passed[SEARCH_STAGES];  /* evaluations that did not reject      */
+    int64_t nanos[SEARCH_STAGES];   /* wall time spent, summed over threads */
+} SearchStats;
+
 typedef struct {
     int            mc_version;
     int64_t        seed_start;
@@ -20,6 +43,11 @@ typedef struct {
     int            max_results;
     StructureQuery structures[MAX_STRUCT_QUERIES];
     int            num_structures;
+    SpawnQuery     spawn;
+    int            num_threads;   /* worker threads, 0 for MAX_THREADS      */
+    SearchStats   *stats;         /* if not NULL, per-stage counters and
+                                     timings are accumulated here (timing
+                                     slows the search down somewhat)        */
 } SearchRequest;
 
 typedef struct {
@@ -46,6 +74,13 @@ int parse_structure_type(const char *name);
  */
 int parse_biome_name(const char *name);
 
+/*
+ * Returns the maximum block distance between estimateSpawn() and getSpawn()
+ * for the given version, or -1 if the refinement is not bounded (1.12 and
+ * older perform a random walk of up to 1000 steps).
+ */
+int spawn_estimate_error(int mc_version);
+
 /*
  * Run a multithreaded seed search according to *req and write the results
  * into *result (which must be zero-initialised by the caller).
@@ -6,6 +6,7 @@
 #include <microhttpd.h>
 
 #include "api.h"
+#include "tiles.h"
 
 #define DEFAULT_PORT 8080
 
@@ -29,6 +30,22 @@ int main(int argc, char *argv[])
     RateLimiter rl;
     rate_limiter_init(&rl);
 
+    if (tiles_init(TILE_CACHE_BYTES) != 0) {
+        fprintf(stderr, "Failed to allocate the tile cache\n");
+        rate_limiter_destroy(&rl);
+        return 1;
+    }
+
+    /* Any further arguments are prerendered tile pyramids (see mkpyramid). */
+    for (int i = 2; i < argc; i++) {
+        if (tiles_add_pyramid(argv[i]) != 0) {
+            fprintf(stderr, "Failed to load tile pyramid %s\n", argv[i]);
+            tiles_destroy();
+            rate_limiter_destroy(&rl);
+            return 1;
+        }
+    }
+
     struct MHD_Daemon *daemon =
         MHD_start_daemon(MHD_USE_INTERNAL_POLLING_THREAD | MHD_ALLOW_UPGRADE,
                          (uint16_t)port,
@@ -40,6 +57,7 @@ int main(int argc, char *argv[])
 
     if (!daemon) {
         fprintf(stderr, "Failed to start HTTP server on port %d\n", port);
+        tiles_destroy();
         rate_limiter_destroy(&rl);
         return 1;
     }
@@ -49,6 +67,8 @@ int main(int argc, char *argv[])
     printf("  GET  http://localhost:%d/biomes\n", port);
     printf("  POST http://localhost:%d/search\n", port);
     printf("  WS   ws://localhost:%d/search/stream\n", port);
+    printf("  GET  http://localhost:%d/tile/{seed}/{mc}/{dim}/{zoom}/{x}/{y}\n",
+           port);
     printf("Rate limit: %d requests per %d seconds per IP\n",
            RATE_LIMIT_MAX_REQS, RATE_LIMIT_WINDOW);
     printf("Press Ctrl-C to stop.\n");
@@ -57,6 +77,7 @@ int main(int argc, char *argv[])
         sleep(1);
 
     MHD_stop_daemon(daemon);
+    tiles_destroy();
     rate_limiter_destroy(&rl);
     printf("\nServer stopped.\n");
     return 0;
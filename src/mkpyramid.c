@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pyramid.h"
+#include "../util.h"
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [options] <output>\n"
+        "  -s <seed>      world seed (default 0)\n"
+        "  -v <version>   Minecraft version, e.g. 1.21 (default 1.21)\n"
+        "  -d <dim>       overworld, nether or end (default overworld)\n"
+        "  -l             large biomes\n"
+        "  -z <min-max>   zoom levels, 0 = 1:256 ... %d = 1:1 (default 0-%d)\n"
+        "  -r <blocks>    radius around (0,0) to cover (default 4096)\n"
+        "  -e <encoding>  png, raw or palette (default png)\n"
+        "  -t <threads>   worker threads (default: online CPUs)\n",
+        prog, TILE_MAX_ZOOM, TILE_MAX_ZOOM);
+}
+
+static void print_progress(size_t done, size_t total)
+{
+    if (done == total || done % 64 == 0) {
+        fprintf(stderr, "\r%zu / %zu tiles", done, total);
+        if (done == total)
+            fputc('\n', stderr);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    PyramidSpec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.mc       = MC_1_21;
+    spec.dim      = DIM_OVERWORLD;
+    spec.max_zoom = TILE_MAX_ZOOM;
+    spec.radius   = 4096;
+    spec.encoding = PYRAMID_PNG;
+    spec.threads  = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:v:d:lz:r:e:t:h")) != -1) {
+        switch (opt) {
+        case 's':
+            spec.seed = (uint64_t)strtoll(optarg, NULL, 10);
+            break;
+        case 'v':
+            spec.mc = str2mc(optarg);
+            if (spec.mc == MC_UNDEF) {
+                fprintf(stderr, "Unknown version: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'd':
+            if (strcmp(optarg, "overworld") == 0)
+                spec.dim = DIM_OVERWORLD;
+            else if (strcmp(optarg, "nether") == 0)
+                spec.dim = DIM_NETHER;
+            else if (strcmp(optarg, "end") == 0)
+                spec.dim = DIM_END;
+            else {
+                fprintf(stderr, "Unknown dimension: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'l':
+            spec.flags |= LARGE_BIOMES;
+            break;
+        case 'z':
+            if (sscanf(optarg, "%d-%d", &spec.min_zoom, &spec.max_zoom) != 2)
+                spec.max_zoom = spec.min_zoom = atoi(optarg);
+            break;
+        case 'r':
+            spec.radius = atoi(optarg);
+            break;
+        case 'e':
+            if (strcmp(optarg, "png") == 0)
+                spec.encoding = PYRAMID_PNG;
+            else if (strcmp(optarg, "raw") == 0)
+                spec.encoding = PYRAMID_RAW;
+            else if (strcmp(optarg, "palette") == 0)
+                spec.encoding = PYRAMID_PALETTE;
+            else {
+                fprintf(stderr, "Unknown encoding: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 't':
+            spec.threads = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int ret = pyramid_build(&spec, argv[optind], print_progress);
+    if (ret < 0)
+        fprintf(stderr, "Invalid arguments or out of memory\n");
+    else if (ret > 0)
+        fprintf(stderr, "Failed to write %s\n", argv[optind]);
+    return ret != 0;
+}
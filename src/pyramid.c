@@ -0,0 +1,396 @@
+#include "pyramid.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../generator.h"
+#include "../util.h"
+
+#define PYRAMID_BYTE_ORDER 0x01020304u
+#define TILE_CELLS         (TILE_SIZE * TILE_SIZE)
+
+/* ── payload encodings ───────────────────────────────────────────────────── */
+
+static int palette_bits(int n)
+{
+    if (n <= 1)  return 0;
+    if (n <= 2)  return 1;
+    if (n <= 4)  return 2;
+    if (n <= 16) return 4;
+    return 8;
+}
+
+static size_t palette_size(int n)
+{
+    return 1 + (size_t)n + ((size_t)TILE_CELLS * palette_bits(n) + 7) / 8;
+}
+
+static unsigned char *encode_palette(const int *ids, size_t *len)
+{
+    int slot[256], n = 0;
+    unsigned char pal[256];
+    memset(slot, -1, sizeof(slot));
+    for (int i = 0; i < TILE_CELLS; i++) {
+        unsigned char id = (unsigned char)ids[i];
+        if (slot[id] < 0) {
+            slot[id] = n;
+            pal[n++] = id;
+        }
+    }
+
+    int bits = palette_bits(n);
+    *len = palette_size(n);
+    unsigned char *buf = (unsigned char *)calloc(1, *len);
+    if (!buf)
+        return NULL;
+    buf[0] = (unsigned char)n;  /* 256 wraps to 0 */
+    memcpy(buf + 1, pal, n);
+    if (bits) {
+        unsigned char *dst = buf + 1 + n;
+        for (int i = 0; i < TILE_CELLS; i++) {
+            size_t bit = (size_t)i * bits;
+            dst[bit >> 3] |= slot[(unsigned char)ids[i]] << (bit & 7);
+        }
+    }
+    return buf;
+}
+
+int pyramid_decode_ids(int encoding, const unsigned char *data, size_t len,
+                       int *ids)
+{
+    if (encoding == PYRAMID_RAW) {
+        if (len != TILE_CELLS)
+            return -1;
+        for (int i = 0; i < TILE_CELLS; i++)
+            ids[i] = data[i];
+        return 0;
+    }
+    if (encoding != PYRAMID_PALETTE || len < 1)
+        return -1;
+
+    int n = data[0] ? data[0] : 256;
+    int bits = palette_bits(n);
+    if (len != palette_size(n))
+        return -1;
+    const unsigned char *pal = data + 1;
+    const unsigned char *src = data + 1 + n;
+    int mask = (1 << bits) - 1;
+    for (int i = 0; i < TILE_CELLS; i++) {
+        int k = 0;
+        if (bits) {
+            size_t bit = (size_t)i * bits;
+            k = (src[bit >> 3] >> (bit & 7)) & mask;
+        }
+        if (k >= n)
+            return -1;
+        ids[i] = pal[k];
+    }
+    return 0;
+}
+
+/* ── builder ─────────────────────────────────────────────────────────────── */
+
+typedef struct {
+    const PyramidSpec *spec;
+    PyramidHeader      hdr;
+    PyramidEntry      *entries[TILE_MAX_ZOOM + 1];
+    size_t             first[TILE_MAX_ZOOM + 2]; /* first job of each zoom */
+
+    pthread_mutex_t    mutex;
+    FILE              *fp;
+    uint64_t           offset;      /* end of the written payloads          */
+    size_t             next, done;
+    int                err;         /* -1 allocation, 1 I/O                 */
+    void             (*progress)(size_t done, size_t total);
+
+    unsigned char      colors[256][3];
+} BuildState;
+
+static int64_t floor_div(int64_t a, int64_t b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/* Tiles of a zoom level that cover the blocks [-radius, radius). */
+static void level_extent(int zoom, int radius, PyramidLevel *lv)
+{
+    int64_t cell = tile_zoom_scale(zoom);
+    int64_t c0 = floor_div(-(int64_t)radius, cell);
+    int64_t c1 = floor_div((int64_t)radius - 1, cell);
+    lv->x0 = lv->y0 = (int32_t)floor_div(c0, TILE_SIZE);
+    lv->nx = lv->ny = (int32_t)(floor_div(c1, TILE_SIZE) - lv->x0 + 1);
+}
+
+static unsigned char *encode_payload(BuildState *st, const int *ids,
+                                     size_t *len)
+{
+    switch (st->spec->encoding) {
+    case PYRAMID_PNG: {
+        unsigned char *enc = NULL;
+        unsigned char *pixels = (unsigned char *)malloc(3 * TILE_CELLS);
+        if (pixels) {
+            biomesToImage(pixels, st->colors, ids, TILE_SIZE, TILE_SIZE, 1, 1);
+            enc = encodePNG(pixels, TILE_SIZE, TILE_SIZE, 1, len);
+        }
+        free(pixels);
+        return enc;
+    }
+    case PYRAMID_RAW: {
+        unsigned char *buf = (unsigned char *)malloc(TILE_CELLS);
+        if (buf) {
+            for (int i = 0; i < TILE_CELLS; i++)
+                buf[i] = (unsigned char)ids[i];
+            *len = TILE_CELLS;
+        }
+        return buf;
+    }
+    default:
+        return encode_palette(ids, len);
+    }
+}
+
+static void *build_worker(void *arg)
+{
+    BuildState *st = (BuildState *)arg;
+    const PyramidSpec *spec = st->spec;
+    size_t total = st->first[spec->max_zoom + 1];
+
+    Generator *g = (Generator *)malloc(sizeof(Generator));
+    if (!g) {
+        pthread_mutex_lock(&st->mutex);
+        st->err = -1;
+        pthread_mutex_unlock(&st->mutex);
+        return NULL;
+    }
+    setupGenerator(g, spec->mc, spec->flags);
+    applySeed(g, spec->dim, spec->seed);
+
+    for (;;) {
+        pthread_mutex_lock(&st->mutex);
+        size_t job = st->err ? total : st->next++;
+        pthread_mutex_unlock(&st->mutex);
+        if (job >= total)
+            break;
+
+        int zoom = spec->min_zoom;
+        while (job >= st->first[zoom + 1])
+            zoom++;
+        const PyramidLevel *lv = &st->hdr.levels[zoom];
+        size_t i = job - st->first[zoom];
+
+        TileKey key = {
+            spec->seed, spec->mc, spec->flags, spec->dim, zoom,
+            lv->x0 + (int)(i % lv->nx), lv->y0 + (int)(i / lv->nx)
+        };
+        size_t len = 0;
+        unsigned char *enc = NULL;
+        int *ids = tile_generate(g, &key);
+        if (ids)
+            enc = encode_payload(st, ids, &len);
+        free(ids);
+
+        pthread_mutex_lock(&st->mutex);
+        if (!enc) {
+            st->err = -1;
+        } else if (!st->err) {
+            if (fwrite(enc, 1, len, st->fp) != len) {
+                st->err = 1;
+            } else {
+                st->entries[zoom][i].offset = st->offset;
+                st->entries[zoom][i].len    = (uint32_t)len;
+                st->offset += len;
+                st->done++;
+                if (st->progress)
+                    st->progress(st->done, total);
+            }
+        }
+        pthread_mutex_unlock(&st->mutex);
+        free(enc);
+    }
+
+    free(g);
+    return NULL;
+}
+
+int pyramid_build(const PyramidSpec *spec, const char *path,
+                  void (*progress)(size_t done, size_t total))
+{
+    if (spec->min_zoom < 0 || spec->max_zoom > TILE_MAX_ZOOM ||
+        spec->min_zoom > spec->max_zoom || spec->radius <= 0 ||
+        spec->radius > 30000000 || spec->encoding < PYRAMID_PNG ||
+        spec->encoding > PYRAMID_PALETTE ||
+        (spec->dim != DIM_OVERWORLD && spec->dim != DIM_NETHER &&
+         spec->dim != DIM_END))
+        return -1;
+
+    BuildState st;
+    memset(&st, 0, sizeof(st));
+    st.spec     = spec;
+    st.progress = progress;
+    initBiomeColors(st.colors);
+
+    PyramidHeader *hdr = &st.hdr;
+    memcpy(hdr->magic, PYRAMID_MAGIC, sizeof(hdr->magic));
+    hdr->version    = PYRAMID_VERSION;
+    hdr->byte_order = PYRAMID_BYTE_ORDER;
+    hdr->encoding   = (uint32_t)spec->encoding;
+    hdr->tile_size  = TILE_SIZE;
+    hdr->seed       = spec->seed;
+    hdr->mc         = spec->mc;
+    hdr->flags      = spec->flags;
+    hdr->dim        = spec->dim;
+
+    /* The index tables follow the header, the payloads follow the index. */
+    uint64_t offset = sizeof(PyramidHeader);
+    int ret = 0;
+    for (int z = spec->min_zoom; z <= spec->max_zoom; z++) {
+        PyramidLevel *lv = &hdr->levels[z];
+        level_extent(z, spec->radius, lv);
+        size_t n = (size_t)lv->nx * lv->ny;
+        st.first[z + 1] = st.first[z] + n;
+        lv->index = offset;
+        offset += n * sizeof(PyramidEntry);
+        st.entries[z] = (PyramidEntry *)calloc(n, sizeof(PyramidEntry));
+        if (!st.entries[z])
+            ret = -1;
+    }
+
+    if (ret == 0) {
+        st.fp = fopen(path, "wb");
+        if (!st.fp)
+            ret = 1;
+    }
+    if (ret == 0 && fseek(st.fp, (long)offset, SEEK_SET) != 0)
+        ret = 1;
+
+    if (ret == 0) {
+        int threads = spec->threads < 1 ? 1 : spec->threads;
+        pthread_t *tids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+        st.offset = offset;
+        pthread_mutex_init(&st.mutex, NULL);
+        if (!tids) {
+            st.err = -1;
+        } else {
+            int started = 0;
+            for (; started < threads; started++)
+                if (pthread_create(&tids[started], NULL, build_worker, &st))
+                    break;
+            if (started == 0)
+                build_worker(&st);
+            for (int t = 0; t < started; t++)
+                pthread_join(tids[t], NULL);
+            free(tids);
+        }
+        pthread_mutex_destroy(&st.mutex);
+        ret = st.err;
+    }
+
+    if (ret == 0) {
+        if (fseek(st.fp, 0, SEEK_SET) != 0 ||
+            fwrite(hdr, sizeof(*hdr), 1, st.fp) != 1)
+            ret = 1;
+        for (int z = spec->min_zoom; ret == 0 && z <= spec->max_zoom; z++) {
+            size_t n = st.first[z + 1] - st.first[z];
+            if (fwrite(st.entries[z], sizeof(PyramidEntry), n, st.fp) != n)
+                ret = 1;
+        }
+    }
+    if (st.fp && fclose(st.fp) != 0 && ret == 0)
+        ret = 1;
+    if (ret != 0 && st.fp)
+        remove(path);
+    for (int z = 0; z <= TILE_MAX_ZOOM; z++)
+        free(st.entries[z]);
+    return ret;
+}
+
+/* ── memory-mapped reader ────────────────────────────────────────────────── */
+
+struct Pyramid {
+    const unsigned char *map;
+    size_t               size;
+};
+
+Pyramid *pyramid_open(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat sb;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(PyramidHeader))
+        map = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    size_t size = (size_t)sb.st_size;
+    const PyramidHeader *hdr = (const PyramidHeader *)map;
+    int ok = memcmp(hdr->magic, PYRAMID_MAGIC, sizeof(hdr->magic)) == 0 &&
+             hdr->version == PYRAMID_VERSION &&
+             hdr->byte_order == PYRAMID_BYTE_ORDER &&
+             hdr->tile_size == TILE_SIZE &&
+             hdr->encoding <= PYRAMID_PALETTE;
+    for (int z = 0; ok && z <= TILE_MAX_ZOOM; z++) {
+        const PyramidLevel *lv = &hdr->levels[z];
+        if (lv->nx == 0)
+            continue;
+        uint64_t n = (uint64_t)lv->nx * (uint64_t)lv->ny;
+        ok = lv->nx > 0 && lv->ny > 0 && lv->index % 8 == 0 &&
+             lv->index <= size && n <= (size - lv->index) / sizeof(PyramidEntry);
+    }
+
+    Pyramid *p = ok ? (Pyramid *)malloc(sizeof(Pyramid)) : NULL;
+    if (!p) {
+        munmap(map, size);
+        return NULL;
+    }
+    /* Tiles are fetched in no particular order. */
+    madvise(map, size, MADV_RANDOM);
+    p->map  = (const unsigned char *)map;
+    p->size = size;
+    return p;
+}
+
+void pyramid_close(Pyramid *p)
+{
+    if (!p)
+        return;
+    munmap((void *)p->map, p->size);
+    free(p);
+}
+
+const PyramidHeader *pyramid_header(const Pyramid *p)
+{
+    return (const PyramidHeader *)p->map;
+}
+
+int pyramid_find(const Pyramid *p, const TileKey *key,
+                 const unsigned char **data, size_t *len)
+{
+    const PyramidHeader *hdr = pyramid_header(p);
+    if (hdr->seed != key->seed || hdr->mc != key->mc ||
+        hdr->flags != key->flags || hdr->dim != key->dim ||
+        key->zoom < 0 || key->zoom > TILE_MAX_ZOOM)
+        return -1;
+
+    const PyramidLevel *lv = &hdr->levels[key->zoom];
+    int64_t x = (int64_t)key->x - lv->x0;
+    int64_t y = (int64_t)key->y - lv->y0;
+    if (x < 0 || x >= lv->nx || y < 0 || y >= lv->ny)
+        return -1;
+
+    const PyramidEntry *e =
+        (const PyramidEntry *)(p->map + lv->index) + (y * lv->nx + x);
+    if (e->len == 0 || e->offset > p->size || e->len > p->size - e->offset)
+        return -1;
+    *data = p->map + e->offset;
+    *len  = e->len;
+    return (int)hdr->encoding;
+}
@@ -0,0 +1,115 @@
+#ifndef PYRAMID_H_
+#define PYRAMID_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tiles.h"
+
+/*
+ * Prerendered tile pyramid container.
+ *
+ * A pyramid file holds the tiles of one seed, version, world type and
+ * dimension for a range of zoom levels.  It is laid out to be memory-mapped
+ * and served without any copies or decoding:
+ *
+ *   PyramidHeader                 fixed-size header with one PyramidLevel
+ *                                 per zoom level (nx == 0 if absent)
+ *   PyramidEntry[nx*ny] ...       tile index of each level, row-major in y
+ *   tile payloads ...             encoded tiles, referenced by the index
+ *
+ * All fields are stored in host byte order; pyramid_open() rejects files
+ * written on a machine of the other endianness.
+ */
+
+#define PYRAMID_MAGIC      "CBPYRAM1"
+#define PYRAMID_VERSION    1
+#define PYRAMID_MAX_FILES  16         /* pyramids the server can open        */
+
+typedef enum {
+    PYRAMID_PNG = 0,    /* tile payloads are PNG images (served as-is)       */
+    PYRAMID_RAW,        /* TILE_SIZE^2 biome IDs, one byte each              */
+    PYRAMID_PALETTE,    /* palette-compressed biome IDs, see below           */
+} PyramidEncoding;
+
+/*
+ * PYRAMID_PALETTE payload: one byte with the palette size n (0 for 256),
+ * n biome IDs, then the TILE_SIZE^2 palette indices packed LSB-first with
+ * 0, 1, 2, 4 or 8 bits each (the fewest that can hold n - 1).
+ */
+
+typedef struct {
+    int32_t  x0, y0;        /* first tile coordinate of this level           */
+    int32_t  nx, ny;        /* tiles along x and y                           */
+    uint64_t index;         /* file offset of the PyramidEntry table         */
+} PyramidLevel;
+
+typedef struct {
+    uint64_t offset;        /* file offset of the payload                    */
+    uint32_t len;           /* payload size, 0 if the tile is missing        */
+    uint32_t reserved;
+} PyramidEntry;
+
+typedef struct {
+    char         magic[8];
+    uint32_t     version;
+    uint32_t     byte_order;    /* 0x01020304 as written by the host         */
+    uint32_t     encoding;      /* PyramidEncoding                           */
+    uint32_t     tile_size;     /* TILE_SIZE                                 */
+    uint64_t     seed;
+    int32_t      mc;
+    uint32_t     flags;
+    int32_t      dim;
+    uint32_t     reserved;
+    PyramidLevel levels[TILE_MAX_ZOOM + 1];
+} PyramidHeader;
+
+typedef struct {
+    uint64_t seed;
+    int      mc;
+    uint32_t flags;
+    int      dim;
+    int      min_zoom, max_zoom;
+    int      radius;        /* blocks around (0,0) that are covered          */
+    int      encoding;      /* PyramidEncoding                               */
+    int      threads;
+} PyramidSpec;
+
+typedef struct Pyramid Pyramid;
+
+/*
+ * Render every tile of the pyramid described by *spec in parallel and write
+ * the container to path.  progress, if not NULL, is called after each tile
+ * with the number of finished and total tiles (from a worker thread, but
+ * never concurrently).  Returns 0 on success, -1 on invalid arguments or
+ * allocation failure, and 1 on an I/O error.
+ */
+int pyramid_build(const PyramidSpec *spec, const char *path,
+                  void (*progress)(size_t done, size_t total));
+
+/*
+ * Map a pyramid file into memory.  Returns NULL if the file cannot be
+ * opened or is not a valid pyramid.
+ */
+Pyramid *pyramid_open(const char *path);
+void     pyramid_close(Pyramid *p);
+
+/* Describe the seed, version, flags and dimension of an open pyramid. */
+const PyramidHeader *pyramid_header(const Pyramid *p);
+
+/*
+ * Look up a tile.  On success *data points into the mapping (valid until
+ * pyramid_close()) and the payload encoding is returned; returns -1 if the
+ * pyramid does not contain the tile.
+ */
+int pyramid_find(const Pyramid *p, const TileKey *key,
+                 const unsigned char **data, size_t *len);
+
+/*
+ * Expand a PYRAMID_RAW or PYRAMID_PALETTE payload into TILE_SIZE^2 biome
+ * IDs.  Returns 0 on success, or -1 if the payload is malformed.
+ */
+int pyramid_decode_ids(int encoding, const unsigned char *data, size_t len,
+                       int *ids);
+
+#endif /* PYRAMID_H_ */
@@ -0,0 +1,410 @@
+#include "tiles.h"
+#include "pyramid.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../generator.h"
+#include "../util.h"
+
+/* ── seeded generator LRU ────────────────────────────────────────────────── */
+
+/* Seeding a generator (in particular the 1.18+ climate noise) costs far more
+ * than rendering a small tile, so a handful of seeded generators are kept
+ * alive.  Slots in use by a renderer are pinned with a reference count and
+ * are never evicted; genBiomes() only reads the generator, so several
+ * renderers may share one slot.  A new slot is reserved under the mutex
+ * (refs > 0 but not yet valid) and seeded outside of it, so other requests
+ * are not held up; requests for the same generator wait until it is ready. */
+
+typedef struct {
+    uint64_t  seed;
+    int       mc;
+    uint32_t  flags;
+    int       dim;
+    int       valid;
+    int       refs;
+    uint64_t  last_used;
+    Generator g;
+} GenSlot;
+
+/* ── encoded tile LRU ────────────────────────────────────────────────────── */
+
+typedef struct TileEntry TileEntry;
+struct TileEntry {
+    TileKey        key;
+    unsigned char *data;
+    size_t         len;
+    TileEntry     *hnext;           /* hash-bucket chain     */
+    TileEntry     *prev, *next;     /* LRU list, head = MRU  */
+};
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t  gen_ready;      /* a reserved slot has been seeded */
+    int             initialized;
+
+    GenSlot        *gens;
+    uint64_t        tick;
+
+    TileEntry      *buckets[TILE_HASH_SIZE];
+    TileEntry      *head, *tail;
+    size_t          bytes;
+    size_t          max_bytes;
+
+    Pyramid        *pyramids[PYRAMID_MAX_FILES];
+    int             npyramids;
+
+    unsigned char   colors[256][3];
+} g_tiles = { .mutex = PTHREAD_MUTEX_INITIALIZER,
+              .gen_ready = PTHREAD_COND_INITIALIZER };
+
+int tiles_init(size_t max_bytes)
+{
+    pthread_mutex_lock(&g_tiles.mutex);
+    if (!g_tiles.initialized) {
+        g_tiles.gens = (GenSlot *)calloc(TILE_GEN_SLOTS, sizeof(GenSlot));
+        if (!g_tiles.gens) {
+            pthread_mutex_unlock(&g_tiles.mutex);
+            return -1;
+        }
+        initBiomeColors(g_tiles.colors);
+        g_tiles.initialized = 1;
+    }
+    g_tiles.max_bytes = max_bytes;
+    pthread_mutex_unlock(&g_tiles.mutex);
+    return 0;
+}
+
+void tiles_destroy(void)
+{
+    pthread_mutex_lock(&g_tiles.mutex);
+    TileEntry *e = g_tiles.head;
+    while (e) {
+        TileEntry *next = e->next;
+        free(e->data);
+        free(e);
+        e = next;
+    }
+    memset(g_tiles.buckets, 0, sizeof(g_tiles.buckets));
+    g_tiles.head = g_tiles.tail = NULL;
+    g_tiles.bytes = 0;
+    free(g_tiles.gens);
+    g_tiles.gens = NULL;
+    for (int i = 0; i < g_tiles.npyramids; i++)
+        pyramid_close(g_tiles.pyramids[i]);
+    g_tiles.npyramids = 0;
+    g_tiles.initialized = 0;
+    pthread_mutex_unlock(&g_tiles.mutex);
+}
+
+int tile_zoom_scale(int zoom)
+{
+    static const int scales[TILE_MAX_ZOOM + 1] = { 256, 64, 16, 4, 1 };
+    if (zoom < 0 || zoom > TILE_MAX_ZOOM)
+        return 0;
+    return scales[zoom];
+}
+
+int tiles_add_pyramid(const char *path)
+{
+    Pyramid *p = pyramid_open(path);
+    if (!p)
+        return -1;
+    pthread_mutex_lock(&g_tiles.mutex);
+    if (g_tiles.npyramids == PYRAMID_MAX_FILES) {
+        pthread_mutex_unlock(&g_tiles.mutex);
+        pyramid_close(p);
+        return -1;
+    }
+    g_tiles.pyramids[g_tiles.npyramids++] = p;
+    pthread_mutex_unlock(&g_tiles.mutex);
+    return 0;
+}
+
+/* Must be called with the mutex held, which is released while waiting for a
+ * slot that another request is seeding.  If *fresh is set, the slot is
+ * reserved for the caller, who has to seed it after unlocking and then
+ * publish it with gen_publish(). */
+static GenSlot *gen_acquire(uint64_t seed, int mc, uint32_t flags, int dim,
+                            int *fresh)
+{
+    GenSlot *victim;
+restart:
+    victim = NULL;
+    for (int i = 0; i < TILE_GEN_SLOTS; i++) {
+        GenSlot *s = &g_tiles.gens[i];
+        if ((s->valid || s->refs) && s->seed == seed && s->mc == mc &&
+            s->flags == flags && s->dim == dim) {
+            if (!s->valid) {
+                pthread_cond_wait(&g_tiles.gen_ready, &g_tiles.mutex);
+                goto restart;
+            }
+            s->refs++;
+            s->last_used = ++g_tiles.tick;
+            *fresh = 0;
+            return s;
+        }
+        if (s->refs == 0 && (!victim || !s->valid ||
+            (victim->valid && s->last_used < victim->last_used)))
+            victim = s;
+    }
+    if (!victim)
+        return NULL;
+
+    victim->seed      = seed;
+    victim->mc        = mc;
+    victim->flags     = flags;
+    victim->dim       = dim;
+    victim->valid     = 0;
+    victim->refs      = 1;
+    victim->last_used = ++g_tiles.tick;
+    *fresh = 1;
+    return victim;
+}
+
+/* Seeds a slot reserved by gen_acquire(), without holding the mutex. */
+static void gen_publish(GenSlot *slot)
+{
+    setupGenerator(&slot->g, slot->mc, slot->flags);
+    applySeed(&slot->g, slot->dim, slot->seed);
+
+    pthread_mutex_lock(&g_tiles.mutex);
+    slot->valid = 1;
+    pthread_cond_broadcast(&g_tiles.gen_ready);
+    pthread_mutex_unlock(&g_tiles.mutex);
+}
+
+/* ── tile cache primitives (mutex held) ──────────────────────────────────── */
+
+static uint32_t tile_hash(const TileKey *k)
+{
+    uint64_t h = k->seed * 0x9e3779b97f4a7c15ULL;
+    h ^= (uint64_t)(uint32_t)k->mc    * 0xbf58476d1ce4e5b9ULL;
+    h ^= (uint64_t)k->flags           * 0x94d049bb133111ebULL;
+    h ^= (uint64_t)(uint32_t)k->dim   * 0x2545f4914f6cdd1dULL;
+    h ^= (uint64_t)(uint32_t)k->zoom  << 56;
+    h ^= (uint64_t)(uint32_t)k->x     * 0xff51afd7ed558ccdULL;
+    h ^= (uint64_t)(uint32_t)k->y     * 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (uint32_t)(h % TILE_HASH_SIZE);
+}
+
+static int tile_key_eq(const TileKey *a, const TileKey *b)
+{
+    return a->seed == b->seed && a->mc == b->mc && a->flags == b->flags &&
+           a->dim == b->dim && a->zoom == b->zoom &&
+           a->x == b->x && a->y == b->y;
+}
+
+static void lru_unlink(TileEntry *e)
+{
+    if (e->prev) e->prev->next = e->next; else g_tiles.head = e->next;
+    if (e->next) e->next->prev = e->prev; else g_tiles.tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void lru_push_front(TileEntry *e)
+{
+    e->prev = NULL;
+    e->next = g_tiles.head;
+    if (g_tiles.head) g_tiles.head->prev = e;
+    g_tiles.head = e;
+    if (!g_tiles.tail) g_tiles.tail = e;
+}
+
+static TileEntry *cache_lookup(const TileKey *key)
+{
+    TileEntry *e = g_tiles.buckets[tile_hash(key)];
+    for (; e; e = e->hnext) {
+        if (tile_key_eq(&e->key, key)) {
+            lru_unlink(e);
+            lru_push_front(e);
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void cache_remove(TileEntry *e)
+{
+    TileEntry **pp = &g_tiles.buckets[tile_hash(&e->key)];
+    while (*pp != e)
+        pp = &(*pp)->hnext;
+    *pp = e->hnext;
+    lru_unlink(e);
+    g_tiles.bytes -= e->len;
+    free(e->data);
+    free(e);
+}
+
+/* Takes ownership of data. */
+static void cache_insert(const TileKey *key, unsigned char *data, size_t len)
+{
+    if (len > g_tiles.max_bytes || cache_lookup(key)) {
+        free(data);
+        return;
+    }
+    while (g_tiles.tail && g_tiles.bytes + len > g_tiles.max_bytes)
+        cache_remove(g_tiles.tail);
+
+    TileEntry *e = (TileEntry *)calloc(1, sizeof(TileEntry));
+    if (!e) {
+        free(data);
+        return;
+    }
+    uint32_t h = tile_hash(key);
+    e->key   = *key;
+    e->data  = data;
+    e->len   = len;
+    e->hnext = g_tiles.buckets[h];
+    g_tiles.buckets[h] = e;
+    lru_push_front(e);
+    g_tiles.bytes += len;
+}
+
+/* ── rendering ───────────────────────────────────────────────────────────── */
+
+static const char g_tile_mime[] = "image/png";
+
+/* Encode an RGB tile as a palette PNG.  Tiles are small, and requests are
+ * already served concurrently, so the encoder runs on a single thread. */
+static unsigned char *encode_tile(const unsigned char *pixels, int w, int h,
+                                  size_t *len)
+{
+    return encodePNG(pixels, w, h, 1, len);
+}
+
+static unsigned char *copy_bytes(const unsigned char *src, size_t len)
+{
+    unsigned char *dst = (unsigned char *)malloc(len ? len : 1);
+    if (dst)
+        memcpy(dst, src, len);
+    return dst;
+}
+
+int *tile_generate(const Generator *g, const TileKey *key)
+{
+    int scale = tile_zoom_scale(key->zoom);
+    if (!scale)
+        return NULL;
+
+    /* Sample at sea level: 1:1 vertical scale at 1:1, 1:4 otherwise. */
+    Range r = { scale, key->x * TILE_SIZE, key->y * TILE_SIZE,
+                TILE_SIZE, TILE_SIZE, scale == 1 ? 63 : 15, 1 };
+
+    int *ids = allocCache(g, r);
+    if (ids && genBiomes(g, ids, r) != 0) {
+        free(ids);
+        ids = NULL;
+    }
+    return ids;
+}
+
+static unsigned char *render_ids(const int *ids, size_t *len)
+{
+    unsigned char *enc = NULL;
+    unsigned char *pixels = (unsigned char *)malloc(3 * TILE_SIZE * TILE_SIZE);
+    if (pixels) {
+        biomesToImage(pixels, g_tiles.colors, ids, TILE_SIZE, TILE_SIZE, 1, 1);
+        enc = encode_tile(pixels, TILE_SIZE, TILE_SIZE, len);
+    }
+    free(pixels);
+    return enc;
+}
+
+TileStatus tile_render(const TileKey *key, const unsigned char **data,
+                       size_t *len, const char **mime, int *owned)
+{
+    int scale = tile_zoom_scale(key->zoom);
+    if (!scale || (key->dim != DIM_OVERWORLD && key->dim != DIM_NETHER &&
+                   key->dim != DIM_END))
+        return TILE_ERR_ARGS;
+
+    /* Tile coordinates are in cells at the tile scale; keep them in range of
+     * the int block coordinates used by the generator. */
+    int64_t lim = (int64_t)(30000000 / scale) / TILE_SIZE + 1;
+    if (key->x < -lim || key->x >= lim || key->y < -lim || key->y >= lim)
+        return TILE_ERR_ARGS;
+
+    pthread_mutex_lock(&g_tiles.mutex);
+    if (!g_tiles.initialized) {
+        pthread_mutex_unlock(&g_tiles.mutex);
+        return TILE_ERR_NOMEM;
+    }
+
+    /* Prerendered images are served straight from the mapping; biome IDs
+     * from a pyramid still need to be coloured and encoded once. */
+    const unsigned char *pdat = NULL;
+    size_t plen = 0;
+    int penc = -1;
+    for (int i = 0; i < g_tiles.npyramids && penc < 0; i++)
+        penc = pyramid_find(g_tiles.pyramids[i], key, &pdat, &plen);
+    if (penc == PYRAMID_PNG) {
+        pthread_mutex_unlock(&g_tiles.mutex);
+        *data  = pdat;
+        *len   = plen;
+        *mime  = g_tile_mime;
+        *owned = 0;
+        return TILE_OK;
+    }
+
+    TileEntry *hit = cache_lookup(key);
+    if (hit) {
+        unsigned char *copy = copy_bytes(hit->data, hit->len);
+        *data  = copy;
+        *len   = hit->len;
+        *mime  = g_tile_mime;
+        *owned = 1;
+        pthread_mutex_unlock(&g_tiles.mutex);
+        return copy ? TILE_OK : TILE_ERR_NOMEM;
+    }
+    GenSlot *slot = NULL;
+    int fresh = 0;
+    if (penc < 0) {
+        slot = gen_acquire(key->seed, key->mc, key->flags, key->dim, &fresh);
+        if (!slot) {
+            pthread_mutex_unlock(&g_tiles.mutex);
+            return TILE_ERR_BUSY;
+        }
+    }
+    pthread_mutex_unlock(&g_tiles.mutex);
+
+    if (fresh)
+        gen_publish(slot);
+
+    TileStatus st = TILE_ERR_NOMEM;
+    unsigned char *enc = NULL;
+    size_t enclen = 0;
+    int *ids;
+    if (slot) {
+        ids = tile_generate(&slot->g, key);
+    } else {
+        ids = (int *)malloc(TILE_SIZE * TILE_SIZE * sizeof(int));
+        if (ids && pyramid_decode_ids(penc, pdat, plen, ids) != 0) {
+            free(ids);
+            ids = NULL;
+        }
+    }
+    if (ids)
+        enc = render_ids(ids, &enclen);
+    free(ids);
+
+    pthread_mutex_lock(&g_tiles.mutex);
+    if (slot)
+        slot->refs--;
+    if (enc) {
+        unsigned char *copy = copy_bytes(enc, enclen);
+        *data  = copy;
+        *len   = enclen;
+        *mime  = g_tile_mime;
+        *owned = 1;
+        if (copy)
+            st = TILE_OK;
+        cache_insert(key, enc, enclen);
+    }
+    pthread_mutex_unlock(&g_tiles.mutex);
+    return st;
+}
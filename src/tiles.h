@@ -0,0 +1,70 @@
+#ifndef TILES_H_
+#define TILES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../generator.h"
+
+#define TILE_SIZE          256        /* tile width and height in pixels     */
+#define TILE_MAX_ZOOM      4          /* zoom 0 = 1:256 ... zoom 4 = 1:1     */
+#define TILE_GEN_SLOTS     16         /* seeded generators kept alive        */
+#define TILE_CACHE_BYTES   (64 << 20) /* default encoded-tile cache budget   */
+#define TILE_HASH_SIZE     4096       /* hash-table buckets for cached tiles */
+
+typedef struct {
+    uint64_t seed;
+    int      mc;
+    uint32_t flags;     /* generator flags, e.g. LARGE_BIOMES */
+    int      dim;       /* DIM_OVERWORLD, DIM_NETHER or DIM_END */
+    int      zoom;      /* 0 .. TILE_MAX_ZOOM */
+    int      x, y;      /* tile coordinates at this zoom level */
+} TileKey;
+
+typedef enum {
+    TILE_OK = 0,
+    TILE_ERR_ARGS,      /* key out of range                       */
+    TILE_ERR_BUSY,      /* every generator slot is currently used */
+    TILE_ERR_NOMEM,     /* allocation failed                      */
+} TileStatus;
+
+/*
+ * Initialise the process-wide generator and tile caches.  Encoded tiles are
+ * kept until their total size exceeds max_bytes, after which the least
+ * recently used tiles are evicted.  Returns 0 on success.
+ */
+int  tiles_init(size_t max_bytes);
+void tiles_destroy(void);
+
+/*
+ * Map a zoom level onto the biome scale rendered at that level, where each
+ * pixel of a tile is one biome cell.  Returns 0 for an invalid zoom.
+ */
+int  tile_zoom_scale(int zoom);
+
+/*
+ * Generate the biome IDs of a tile with a generator that has been set up and
+ * seeded for the key's version, flags and dimension.  Returns a malloc()'d
+ * buffer whose first TILE_SIZE^2 entries are the tile, row-major in y, or
+ * NULL on failure.
+ */
+int *tile_generate(const Generator *g, const TileKey *key);
+
+/*
+ * Memory-map a prerendered pyramid (see pyramid.h) and serve its tiles
+ * without rendering.  Returns 0 on success, or -1 if the file is invalid or
+ * PYRAMID_MAX_FILES pyramids are already open.
+ */
+int  tiles_add_pyramid(const char *path);
+
+/*
+ * Render the tile for *key, or fetch it from a pyramid or the cache.  On
+ * success *len is the size of the encoded image and *mime its content type.
+ * If *owned is set, *data is a malloc()'d copy to be freed by the caller;
+ * otherwise it points into a mapped pyramid that stays valid until
+ * tiles_destroy().
+ */
+TileStatus tile_render(const TileKey *key, const unsigned char **data,
+                       size_t *len, const char **mime, int *owned);
+
+#endif /* TILES_H_ */
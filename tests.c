@@ -174,6 +174,83 @@ uint32_t testAreas(int mc, int dim, int scale)
 
 
 
+static int cmpParallel(Generator *g, Range r, int threads)
+{
+    int *a = allocCache(g, r);
+    int *b = allocCache(g, r);
+    int n = 0;
+    int64_t i;
+    int err = genBiomes(g, a, r);
+    if (genBiomesParallel(g, b, r, threads) != err)
+        n = -1;
+    else if (!err)
+    {
+        for (i = 0; i < (int64_t)r.sx*r.sz*(r.sy ? r.sy : 1); i++)
+            n += a[i] != b[i];
+    }
+    free(a);
+    free(b);
+    return n;
+}
+
+/* Checks that genBiomesParallel() gives the same biomes as genBiomes(). */
+int testParallel(int threads)
+{
+    const int mc_vers[] = {
+        MC_1_21, MC_1_18, MC_1_17, MC_1_13, MC_1_7, MC_B1_8, MC_B1_7,
+    };
+    const int scales[] = { 1, 4, 16, 64, 256 };
+    const int testcnt = 150;
+    Generator g;
+    int ok = 1;
+    uint32_t s;
+
+    printf("Testing parallel generation on %d threads:\n", threads);
+    double t = -now();
+    for (s = 0; s < (uint32_t)testcnt; s++)
+    {
+        int mc = mc_vers[s % (sizeof(mc_vers) / sizeof(int))];
+        int dim = (int)(hash32(s << 3) % 3) - 1;
+        int d = 40000;
+        Range r;
+        r.scale = scales[hash32(s << 5) % 5];
+        r.x = hash32(s << 7) % d - d/2;
+        r.z = hash32(s << 9) % d - d/2;
+        r.sx = 1 + hash32(s << 11) % 160;
+        r.sz = 1 + hash32(s << 13) % 160;
+        r.y = (int)(hash32(s << 15) % 64) - 16;
+        r.sy = 1 + hash32(s << 17) % 4;
+        if (mc <= MC_1_17 && r.scale == 1)
+            r.sy = 1; // layered scale 1 is slow and has no vertical noise
+
+        setupGenerator(&g, mc, 0);
+        applySeed(&g, dim, hash32(s << 19) * 0x9E3779B97F4A7C15ULL);
+        int n = cmpParallel(&g, r, threads);
+        if (n)
+        {
+            printf("  MC %-6s dim %-2d @ 1:%-3d (%d,%d,%d %dx%dx%d) - "
+                "%d differ \e[1;91mFAILED\e[0m\n", mc2str(mc), dim, r.scale,
+                r.x, r.y, r.z, r.sx, r.sy, r.sz, n);
+            ok = 0;
+        }
+    }
+
+    // the cells that mapNether3D() fills around its samples depend on the
+    // extent of the range, so a split nether range used to differ
+    Range r = {1, 2880, -5355, 269, 275, 28, 2};
+    setupGenerator(&g, MC_1_18, 0);
+    applySeed(&g, DIM_NETHER, 17314959574940499577ULL);
+    if (cmpParallel(&g, r, threads))
+    {
+        printf("  MC 1.18  dim -1 @ 1:1   nether fill \e[1;91mFAILED\e[0m\n");
+        ok = 0;
+    }
+    t += now();
+    printf("  %d ranges %s\e[0m (%ld msec)\n", testcnt + 1,
+        ok ? "\e[1;92mOK" : "\e[1;91mFAILED", (long)(t*1e3));
+    return ok;
+}
+
 
 int testGeneration()
 {
@@ -534,6 +611,7 @@ int main()
     //testAreas(mc, 0, 256);
     //testCanBiomesGenerate();
     //testGeneration();
+    //testParallel(4);
     //findBiomeParaBounds();
 
     return 0;
@@ -5,6 +5,12 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 
 
 uint64_t *loadSavedSeeds(const char *fnam, uint64_t *scnt)
@@ -586,3 +592,491 @@ int savePPM(const char *path, const unsigned char *pixels, const unsigned int sx
 }
 
 
+
+
+//==============================================================================
+// PNG output
+//==============================================================================
+
+/* A small dependency-free PNG writer. The image is stored with an indexed
+ * palette when it has at most 256 distinct colours (which is always the case
+ * for biome maps), and as 8-bit RGB otherwise. The zlib stream is compressed
+ * with a greedy LZ77 matcher and the fixed Huffman codes of deflate, which
+ * works well for the long runs and repeated rows of biome maps. Row bands can
+ * be compressed in parallel as independent deflate blocks.
+ */
+
+#define PNG_WINDOW      32768
+#define PNG_HASH_BITS   14
+#define PNG_MIN_MATCH   3
+#define PNG_MAX_MATCH   258
+
+STRUCT(PngBits)
+{
+    unsigned char *buf;
+    size_t pos;
+    uint64_t acc;
+    int cnt;
+};
+
+static inline void pngPutBits(PngBits *bw, uint32_t bits, int n)
+{
+    bw->acc |= (uint64_t)bits << bw->cnt;
+    bw->cnt += n;
+    while (bw->cnt >= 8)
+    {
+        bw->buf[bw->pos++] = (unsigned char) bw->acc;
+        bw->acc >>= 8;
+        bw->cnt -= 8;
+    }
+}
+
+static inline void pngAlignBits(PngBits *bw)
+{
+    if (bw->cnt > 0)
+        pngPutBits(bw, 0, 8 - bw->cnt);
+}
+
+// huffman codes are stored msb-first, but the bit stream is lsb-first
+static inline uint32_t pngRevBits(uint32_t code, int n)
+{
+    uint32_t r = 0;
+    while (n--)
+    {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+static void pngPutLiteral(PngBits *bw, int v)
+{
+    if (v < 144)
+        pngPutBits(bw, pngRevBits(0x30 + v, 8), 8);
+    else if (v < 256)
+        pngPutBits(bw, pngRevBits(0x190 + v - 144, 9), 9);
+    else if (v < 280)
+        pngPutBits(bw, pngRevBits(v - 256, 7), 7);
+    else
+        pngPutBits(bw, pngRevBits(0xc0 + v - 280, 8), 8);
+}
+
+static void pngPutMatch(PngBits *bw, int len, int dist)
+{
+    static const uint16_t lbase[29] = {
+        3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,
+        35,43,51,59,67,83,99,115,131,163,195,227,258 };
+    static const uint8_t lext[29] = {
+        0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+    static const uint16_t dbase[30] = {
+        1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,
+        1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+    static const uint8_t dext[30] = {
+        0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+    int i;
+
+    for (i = 28; lbase[i] > len; i--);
+    pngPutLiteral(bw, 257 + i);
+    if (lext[i])
+        pngPutBits(bw, len - lbase[i], lext[i]);
+
+    for (i = 29; dbase[i] > dist; i--);
+    pngPutBits(bw, pngRevBits(i, 5), 5);
+    if (dext[i])
+        pngPutBits(bw, dist - dbase[i], dext[i]);
+}
+
+static inline int pngMatchLen(const unsigned char *a, const unsigned char *b,
+        int maxlen)
+{
+    int n = 0;
+    while (n < maxlen && a[n] == b[n])
+        n++;
+    return n;
+}
+
+/* Deflates dat[beg:end] as a single fixed-Huffman block. Matches may refer
+ * back to data before 'beg' (still within the window), since the decoder
+ * sees the whole stream. The block is byte-aligned on exit: the final band
+ * is padded, other bands are followed by an empty stored block. If the data
+ * does not compress, stored blocks are written instead.
+ * The output buffer needs to hold at least pngBandBound(end-beg) bytes.
+ */
+static size_t pngDeflateBand(unsigned char *out, const unsigned char *dat,
+        size_t beg, size_t end, size_t stride, int last)
+{
+    PngBits bw = { out, 0, 0, 0 };
+    uint32_t *head = (uint32_t*) malloc(sizeof(uint32_t) << PNG_HASH_BITS);
+    size_t i = beg;
+
+    if (head)
+    {
+        memset(head, 0xff, sizeof(uint32_t) << PNG_HASH_BITS);
+        pngPutBits(&bw, last, 1);
+        pngPutBits(&bw, 1, 2); // fixed huffman
+
+        while (i < end)
+        {
+            int best = 0, dist = 0;
+            int maxlen = end - i < PNG_MAX_MATCH ? (int)(end - i) : PNG_MAX_MATCH;
+
+            if (maxlen >= PNG_MIN_MATCH)
+            {
+                uint32_t h = (dat[i] << 16) | (dat[i+1] << 8) | dat[i+2];
+                h = (h * 2654435761u) >> (32 - PNG_HASH_BITS);
+                size_t cand = head[h];
+                head[h] = (uint32_t) i;
+
+                // candidates: previous row, run of the previous byte, hash
+                size_t c[3] = { stride, 1, i - cand };
+                int k;
+                for (k = 0; k < 3; k++)
+                {
+                    if (c[k] == 0 || c[k] > i || c[k] > PNG_WINDOW)
+                        continue;
+                    if (k == 2 && cand == (uint32_t)-1)
+                        continue;
+                    int len = pngMatchLen(dat + i - c[k], dat + i, maxlen);
+                    if (len > best)
+                    {
+                        best = len;
+                        dist = (int) c[k];
+                    }
+                }
+            }
+
+            if (best >= PNG_MIN_MATCH)
+            {
+                pngPutMatch(&bw, best, dist);
+                i += best;
+            }
+            else
+            {
+                pngPutLiteral(&bw, dat[i]);
+                i++;
+            }
+        }
+        pngPutLiteral(&bw, 256);
+        free(head);
+    }
+
+    if (!head || bw.pos > end - beg + (end - beg) / 65535 * 5 + 5)
+    {   // fall back to stored blocks
+        bw.pos = 0;
+        bw.acc = 0;
+        bw.cnt = 0;
+        i = beg;
+        do
+        {
+            size_t n = end - i < 65535 ? end - i : 65535;
+            int final = last && i + n == end;
+            pngPutBits(&bw, final, 1);
+            pngPutBits(&bw, 0, 2);
+            pngAlignBits(&bw);
+            pngPutBits(&bw, n & 0xffff, 16);
+            pngPutBits(&bw, ~n & 0xffff, 16);
+            memcpy(out + bw.pos, dat + i, n);
+            bw.pos += n;
+            i += n;
+        }
+        while (i < end);
+        if (!last)
+        {   // empty stored block for byte alignment
+            pngPutBits(&bw, 0, 3);
+            pngAlignBits(&bw);
+            pngPutBits(&bw, 0x0000, 16);
+            pngPutBits(&bw, 0xffff, 16);
+        }
+        return bw.pos;
+    }
+
+    if (!last)
+    {
+        pngPutBits(&bw, 0, 3);
+        pngAlignBits(&bw);
+        pngPutBits(&bw, 0x0000, 16);
+        pngPutBits(&bw, 0xffff, 16);
+    }
+    pngAlignBits(&bw);
+    return bw.pos;
+}
+
+static size_t pngBandBound(size_t n)
+{   // fixed huffman literals take at most 9 bits
+    return n + n / 8 + n / 65535 * 5 + 64;
+}
+
+STRUCT(PngBand)
+{
+    const unsigned char *dat;
+    unsigned char *out;
+    size_t beg, end, stride, len;
+    int last;
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI pngBandThread(LPVOID data)
+#else
+static void *pngBandThread(void *data)
+#endif
+{
+    PngBand *b = (PngBand*) data;
+    b->len = pngDeflateBand(b->out, b->dat, b->beg, b->end, b->stride, b->last);
+    return 0;
+}
+
+static void pngPut32(unsigned char *p, uint32_t v)
+{
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static uint32_t pngCrc(const uint32_t tab[256], const unsigned char *p, size_t n)
+{
+    uint32_t c = 0xffffffff;
+    while (n--)
+        c = tab[(c ^ *p++) & 0xff] ^ (c >> 8);
+    return c ^ 0xffffffff;
+}
+
+unsigned char *encodePNG(const unsigned char *pixels,
+        const unsigned int sx, const unsigned int sy, int threads, size_t *len)
+{
+    uint32_t crctab[256];
+    unsigned char palette[256][3];
+    uint32_t hkey[1024];
+    int16_t hval[1024];
+    int ncol = 0;
+    size_t i, j, n = (size_t)sx * sy;
+    unsigned char *raw = NULL, *zdat = NULL, *png = NULL;
+    PngBand *bands = NULL;
+
+    if (sx == 0 || sy == 0)
+        return NULL;
+
+    for (i = 0; i < 256; i++)
+    {
+        uint32_t c = (uint32_t) i;
+        for (j = 0; j < 8; j++)
+            c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+        crctab[i] = c;
+    }
+
+    // try to build a palette, using a small open-addressing colour table
+    memset(hval, 0xff, sizeof(hval));
+    for (i = 0; i < n && ncol <= 256; i++)
+    {
+        const unsigned char *p = pixels + 3*i;
+        uint32_t rgb = (p[0] << 16) | (p[1] << 8) | p[2];
+        uint32_t h = (rgb * 2654435761u) >> 22;
+        while (hval[h] >= 0 && hkey[h] != rgb)
+            h = (h + 1) & 1023;
+        if (hval[h] >= 0)
+            continue;
+        if (ncol == 256)
+        {
+            ncol++; // too many colours
+            break;
+        }
+        hkey[h] = rgb;
+        hval[h] = ncol;
+        memcpy(palette[ncol++], p, 3);
+    }
+    int indexed = ncol <= 256;
+    size_t stride = (indexed ? sx : 3 * (size_t)sx) + 1;
+    size_t rawlen = stride * sy;
+
+    // filtered scanlines (filter type 0: none)
+    raw = (unsigned char*) malloc(rawlen);
+    if (!raw)
+        goto L_err;
+    for (j = 0; j < sy; j++)
+    {
+        unsigned char *row = raw + j * stride;
+        const unsigned char *src = pixels + j * 3 * (size_t)sx;
+        row[0] = 0;
+        if (!indexed)
+        {
+            memcpy(row + 1, src, 3 * (size_t)sx);
+            continue;
+        }
+        for (i = 0; i < sx; i++)
+        {
+            const unsigned char *p = src + 3*i;
+            uint32_t rgb = (p[0] << 16) | (p[1] << 8) | p[2];
+            uint32_t h = (rgb * 2654435761u) >> 22;
+            while (hval[h] < 0 || hkey[h] != rgb)
+                h = (h + 1) & 1023;
+            row[1+i] = (unsigned char) hval[h];
+        }
+    }
+
+    // compress row bands, each band is a separate deflate block
+    if (threads < 1)
+        threads = 1;
+    if ((unsigned int)threads > sy)
+        threads = sy;
+    bands = (PngBand*) calloc(threads, sizeof(PngBand));
+    if (!bands)
+        goto L_err;
+    size_t zcap = 0;
+    int t;
+    for (t = 0; t < threads; t++)
+    {
+        bands[t].dat = raw;
+        bands[t].beg = stride * (sy * (size_t)t / threads);
+        bands[t].end = stride * (sy * (size_t)(t+1) / threads);
+        bands[t].stride = stride;
+        bands[t].last = (t == threads - 1);
+        zcap += pngBandBound(bands[t].end - bands[t].beg);
+    }
+    zdat = (unsigned char*) malloc(zcap);
+    if (!zdat)
+        goto L_err;
+    zcap = 0;
+    for (t = 0; t < threads; t++)
+    {
+        bands[t].out = zdat + zcap;
+        zcap += pngBandBound(bands[t].end - bands[t].beg);
+    }
+
+    if (threads == 1)
+    {
+        pngBandThread(&bands[0]);
+    }
+    else
+    {
+#if defined(_WIN32)
+        HANDLE *tids = (HANDLE*) malloc(threads * sizeof(HANDLE));
+        if (!tids)
+            goto L_err;
+        int nt = 0;
+        for (t = 0; t < threads; t++)
+        {   // a band that did not get a thread is compressed here instead
+            tids[nt] = CreateThread(NULL, 0, pngBandThread, &bands[t], 0, NULL);
+            if (tids[nt])
+                nt++;
+            else
+                pngBandThread(&bands[t]);
+        }
+        if (nt)
+            WaitForMultipleObjects(nt, tids, TRUE, INFINITE);
+        for (t = 0; t < nt; t++)
+            CloseHandle(tids[t]);
+#else
+        pthread_t *tids = (pthread_t*) malloc(threads * sizeof(pthread_t));
+        if (!tids)
+            goto L_err;
+        int nt = 0;
+        for (t = 0; t < threads; t++)
+        {   // a band that did not get a thread is compressed here instead
+            if (pthread_create(&tids[nt], NULL, pngBandThread, &bands[t]) == 0)
+                nt++;
+            else
+                pngBandThread(&bands[t]);
+        }
+        for (t = 0; t < nt; t++)
+            pthread_join(tids[t], NULL);
+#endif
+        free(tids);
+    }
+
+    // adler-32 of the uncompressed data
+    uint32_t a = 1, b = 0;
+    for (i = 0; i < rawlen; )
+    {
+        size_t blk = rawlen - i < 5552 ? rawlen - i : 5552;
+        for (j = 0; j < blk; j++)
+        {
+            a += raw[i+j];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        i += blk;
+    }
+
+    size_t idatlen = 2 + 4;
+    for (t = 0; t < threads; t++)
+        idatlen += bands[t].len;
+    if (idatlen > 0x7fffffff)
+        goto L_err;
+
+    size_t plen = 8 + (12+13) + (indexed ? 12 + 3*ncol : 0) + (12+idatlen) + 12;
+    png = (unsigned char*) malloc(plen);
+    if (!png)
+        goto L_err;
+
+    static const unsigned char sig[8] = {137,'P','N','G','\r','\n',26,'\n'};
+    unsigned char *p = png;
+    memcpy(p, sig, 8);
+    p += 8;
+
+    pngPut32(p, 13);
+    memcpy(p+4, "IHDR", 4);
+    pngPut32(p+8, sx);
+    pngPut32(p+12, sy);
+    p[16] = 8;                  // bit depth
+    p[17] = indexed ? 3 : 2;    // colour type
+    p[18] = p[19] = p[20] = 0;  // compression, filter, interlace
+    pngPut32(p+21, pngCrc(crctab, p+4, 17));
+    p += 25;
+
+    if (indexed)
+    {
+        pngPut32(p, 3*ncol);
+        memcpy(p+4, "PLTE", 4);
+        memcpy(p+8, palette, 3*ncol);
+        pngPut32(p+8+3*ncol, pngCrc(crctab, p+4, 4+3*ncol));
+        p += 12 + 3*ncol;
+    }
+
+    pngPut32(p, (uint32_t) idatlen);
+    memcpy(p+4, "IDAT", 4);
+    unsigned char *z = p + 8;
+    z[0] = 0x78;    // deflate, 32K window
+    z[1] = 0x01;    // fastest, check bits
+    z += 2;
+    for (t = 0; t < threads; t++)
+    {
+        memcpy(z, bands[t].out, bands[t].len);
+        z += bands[t].len;
+    }
+    pngPut32(z, (b << 16) | a);
+    pngPut32(p+8+idatlen, pngCrc(crctab, p+4, 4+idatlen));
+    p += 12 + idatlen;
+
+    pngPut32(p, 0);
+    memcpy(p+4, "IEND", 4);
+    pngPut32(p+8, pngCrc(crctab, p+4, 4));
+
+    free(zdat);
+    free(bands);
+    free(raw);
+    *len = plen;
+    return png;
+
+L_err:
+    free(zdat);
+    free(bands);
+    free(raw);
+    return NULL;
+}
+
+int savePNG(const char *path, const unsigned char *pixels,
+        const unsigned int sx, const unsigned int sy)
+{
+    size_t len;
+    unsigned char *png = encodePNG(pixels, sx, sy, 1, &len);
+    if (!png)
+        return 1;
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        free(png);
+        return -1;
+    }
+    size_t written = fwrite(png, 1, len, fp);
+    fclose(fp);
+    free(png);
+    return written != len;
+}
@@ -2,6 +2,7 @@
 #define UTIL_H_
 
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -54,6 +55,21 @@ int biomesToImage(unsigned char *pixels,
 int savePPM(const char* path, const unsigned char *pixels,
         const unsigned int sx, const unsigned int sy);
 
+/* Encode the pixel buffer (e.g. from biomesToImage) as a PNG image. Images
+ * with at most 256 distinct colours use an indexed palette. With threads > 1,
+ * bands of rows are compressed in parallel. Returns a malloc'd buffer holding
+ * the file contents and sets *len to its size, or returns NULL on failure.
+ */
+unsigned char *encodePNG(const unsigned char *pixels,
+        const unsigned int sx, const unsigned int sy, int threads, size_t *len);
+
+/* Save the pixel buffer (e.g. from biomesToImage) to the given path as a PNG
+ * image file. Returns 0 if successful, -1 if the file could not be opened,
+ * or 1 if the image could not be encoded or fully written.
+ */
+int savePNG(const char* path, const unsigned char *pixels,
+        const unsigned int sx, const unsigned int sy);
+
 #ifdef __cplusplus
 }
 #endif